@@ -0,0 +1,197 @@
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "model.h"
+
+// steps random soups with every engine, bounded and unbounded, across grid
+// sizes and densities, and prints generations per second and nanoseconds per
+// cell of the soup as CSV
+
+// time spent stepping each configuration, unless --millis says
+#define INIT_MILLIS 250
+#define BENCH_SEED 1
+
+static const size_t BENCH_HASHLIFE_NODES = 1 << 20;
+
+static const int SIZES[] = {128, 512, 2048};
+static const int DENSITIES[] = {10, 25, 50};
+
+// the ways a model can be stepped. the scalar and active engines have no
+// unbounded form, the universe being stepped a tile at a time either way
+typedef struct Config{
+    Engine engine;
+    bool unbounded;
+} Config;
+
+static const Config CONFIGS[] = {
+    {ENGINE_SCALAR, false},
+    {ENGINE_PACKED, false},
+    {ENGINE_ACTIVE, false},
+    {ENGINE_HASHLIFE, false},
+    {ENGINE_PACKED, true},
+    {ENGINE_HASHLIFE, true},
+};
+
+typedef struct BenchOptions{
+    double millis;
+    int nthreads;
+    uint64_t seed;
+} BenchOptions;
+
+typedef struct Result{
+    uint64_t generations;
+    double ms;
+} Result;
+
+// steps a size x size soup of the given density until the time is up. the
+// soup is the same for every engine, so their results compare
+void bench_run(Config const *config, int size, int chance,
+        BenchOptions const *opts, Result *result)
+{
+    Model *model = model_new(&(ModelConfig){
+        .nrows = size,
+        .ncols = size,
+        .unbounded = config->unbounded,
+        .engine = config->engine,
+        .rule = LIFE_RULE,
+        .boundary = BOUNDARY_DEAD,
+        .nthreads = opts->nthreads,
+        .hashlife_nodes = BENCH_HASHLIFE_NODES,
+        .step_exp = 0,
+    });
+
+    Rng rng;
+    rng_seed(&rng, opts->seed);
+    model_random_fill(model, chance, 0, 0, size, size, &rng);
+    model_invalidate(model);
+
+    double start = now_ms();
+    double elapsed = 0;
+    while (elapsed < opts->millis) {
+        model_step(model);
+        elapsed = now_ms() - start;
+    }
+
+    result->generations = model->generation;
+    result->ms = elapsed;
+    model_destroy(model);
+}
+
+void usage(char const *prog)
+{
+    fprintf(stderr, "usage: %s [--millis MS] [--threads N] [--seed S]\n"
+            "  --millis MS   time to step each engine, size and density for\n"
+            "                (default %d)\n"
+            "  --threads N   worker threads stepping each generation, 0 for one\n"
+            "                per core (default 1)\n"
+            "  --seed S      seed of the random soups (default %d)\n",
+            prog, INIT_MILLIS, BENCH_SEED);
+}
+
+bool parse_long(char const *arg, long min, long max, long *value)
+{
+    char *end;
+    long n = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || n < min || n > max) {
+        return false;
+    }
+    *value = n;
+    return true;
+}
+
+bool parse_options(int argc, char *argv[], BenchOptions *opts)
+{
+    static const struct option long_options[] = {
+        {"millis", required_argument, NULL, 'm'},
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 'S'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    *opts = (BenchOptions){
+        .millis = INIT_MILLIS,
+        .nthreads = 1,
+        .seed = BENCH_SEED,
+    };
+
+    int opt;
+    long value;
+    while ((opt = getopt_long(argc, argv, "m:t:S:h", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (!parse_long(optarg, 1, INT_MAX, &value)) {
+                    fprintf(stderr, "%s: invalid time '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->millis = value;
+                break;
+            case 't':
+                if (!parse_long(optarg, 0, 1024, &value)) {
+                    fprintf(stderr, "%s: invalid thread count '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                if (value == 0) {
+                    value = sysconf(_SC_NPROCESSORS_ONLN);
+                }
+                opts->nthreads = value < 1 ? 1 : (int) value;
+                break;
+            case 'S':
+                if (!parse_long(optarg, 0, LONG_MAX, &value)) {
+                    fprintf(stderr, "%s: invalid seed '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->seed = (uint64_t) value;
+                break;
+            default:
+                return false;
+        }
+    }
+    if (optind < argc) {
+        fprintf(stderr, "%s: unexpected argument '%s'\n", argv[0], argv[optind]);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions opts;
+    if (!parse_options(argc, argv, &opts)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("engine,grid,size,density,generations,seconds,generations_per_sec,ns_per_cell\n");
+    for (size_t i = 0; i < sizeof CONFIGS / sizeof *CONFIGS; i++)
+    {
+        Config const *config = &CONFIGS[i];
+        for (size_t j = 0; j < sizeof SIZES / sizeof *SIZES; j++)
+        {
+            for (size_t k = 0; k < sizeof DENSITIES / sizeof *DENSITIES; k++)
+            {
+                int size = SIZES[j];
+                Result result;
+                bench_run(config, size, DENSITIES[k], &opts, &result);
+
+                // an unbounded soup spreads as it runs, but is measured
+                // against the area it started in
+                double cells = (double) size * size;
+                double seconds = result.ms / 1000;
+                printf("%s,%s,%d,%d,%llu,%.3f,%.1f,%.3f\n", ENGINE_NAMES[config->engine],
+                        config->unbounded ? "unbounded" : "bounded", size, DENSITIES[k],
+                        (unsigned long long) result.generations, seconds,
+                        result.generations / seconds,
+                        result.ms * 1e6 / (result.generations * cells));
+                fflush(stdout);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
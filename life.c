@@ -1,28 +1,176 @@
 #include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <locale.h>
 #include <ncurses/curses.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "model.h"
 
 static const int INIT_DELAY = 250;
 static const int INIT_CHANCE = 25;
+static const int INIT_FPS = 30;
+
+// headless soups are this many cells square unless --size is given
+static const int SOUP_SIZE = 64;
+static const uint64_t INIT_MAX_GENERATIONS = 100000;
+
+// phase timings kept for the rolling statistics
+#define TIMING_SAMPLES 256
+
+// megabytes of checkpoints kept for rewinding, unless --history-size says
+static const long INIT_HISTORY_MB = 32;
+
+// how shown cells become characters: a character each with grid lines
+// between them, or packed without lines two to a half block character or
+// eight to a Braille pattern
+typedef enum Render {RENDER_GRID, RENDER_HALF, RENDER_BRAILLE} Render;
+
+static const char *const RENDER_NAMES[] = {
+    [RENDER_GRID] = "grid",
+    [RENDER_HALF] = "half",
+    [RENDER_BRAILLE] = "braille",
+};
+
+// shown cells down and across each character
+static const int RENDER_ROWS[] = {[RENDER_GRID] = 1, [RENDER_HALF] = 2, [RENDER_BRAILLE] = 4};
+static const int RENDER_COLS[] = {[RENDER_GRID] = 1, [RENDER_HALF] = 1, [RENDER_BRAILLE] = 2};
+
+// Braille dot of the cell at row r, column c of a character, by r * 2 + c
+static const unsigned char BRAILLE_DOTS[] = {0x01, 0x08, 0x02, 0x10, 0x04, 0x20, 0x40, 0x80};
 
 typedef struct View{
     int nlines;
     int ncols;
     int begin_y;
     int begin_x;
+    // model cell shown at the top left, and the side of the square of
+    // model cells each shown cell stands for
+    int top;
+    int left;
+    int zoom;
+    Render render;
 } View;
 
-typedef struct Model{
+static const int MAX_ZOOM = 256;
+
+// hashlife node cache cap, unless --hashlife-nodes says
+static const size_t INIT_HASHLIFE_NODES = 1 << 20;
+
+typedef enum OutputFormat {OUTPUT_CSV, OUTPUT_JSON} OutputFormat;
+
+typedef enum OnCycle {ON_CYCLE_REPORT, ON_CYCLE_PAUSE, ON_CYCLE_FFWD} OnCycle;
+
+static const char *const ON_CYCLE_NAMES[] = {
+    [ON_CYCLE_REPORT] = "report",
+    [ON_CYCLE_PAUSE] = "pause",
+    [ON_CYCLE_FFWD] = "ffwd",
+};
+
+typedef struct Options{
+    Engine engine;
+    Rule rule;
+    Boundary boundary;
+    // grid size, 0 to fit the terminal
     int nrows;
     int ncols;
-    int *grid;
-} Model;
+    bool unbounded;
+    int nthreads;
+    int step_exp;
+    size_t hashlife_nodes;
+    // pattern files to load at start and save at exit, and the file to
+    // write per generation timings to, or NULL
+    char const *load;
+    char const *save;
+    char const *timings;
+    // frames drawn per second while simulating, at most
+    int fps;
+    // headless mode: number of soups to run (0 for the interactive UI),
+    // the area and percent chance they are filled with, the first seed,
+    // and when to give up on one settling
+    long soups;
+    int soup_rows;
+    int soup_cols;
+    int chance;
+    unsigned seed;
+    OutputFormat format;
+    uint64_t max_generations;
+    // what the UI does once the board repeats itself, and the generation
+    // it stops at (0 for none)
+    OnCycle on_cycle;
+    uint64_t target;
+    // bytes of checkpoints kept for rewinding (0 for none), and the file
+    // they are kept in, or NULL for memory
+    size_t history_size;
+    char const *history_file;
+    Render render;
+} Options;
 
 typedef enum State {EXIT, PROCEED} State;
 
+// displayed glyph (see put_glyph) of each character of a view
+typedef struct Frame{
+    int nrows;
+    int ncols;
+    unsigned char *glyphs;
+    // the shown cells of a row of characters while sampling, as a row of
+    // nwords bit packed words per shown row
+    int nwords;
+    uint64_t *rows;
+} Frame;
+
+// the last TIMING_SAMPLES durations of a phase, in milliseconds
+typedef struct Timing{
+    double samples[TIMING_SAMPLES];
+    uint64_t count;
+} Timing;
+
+// the thread stepping the model while simulating
+typedef struct Sim{
+    Model *model;
+    pthread_t thread;
+    // held by the sim thread while stepping, and by the UI while reading
+    // the model
+    pthread_mutex_t lock;
+    // signalled when the UI is done with the model or unpauses
+    pthread_cond_t wake;
+    atomic_bool sample_wanted;
+    // milliseconds between generations, 0 for as fast as possible
+    double delay;
+    bool paused;
+    bool quit;
+    // cycle detection, and the generation to stop at (0 for none)
+    History history;
+    OnCycle on_cycle;
+    uint64_t target;
+    bool cycle_found;
+    uint64_t cycle_start;
+    uint64_t cycle_period;
+    Timing step_timing;
+    // per generation timings are written here, unless NULL
+    FILE *timings;
+    // checkpoints to seek back with, NULL if the model can't be rewound
+    Timeline *timeline;
+} Sim;
+
+// what the status row shows of the sim thread's state
+typedef struct SimStatus{
+    uint64_t generation;
+    bool paused;
+    bool cycle_found;
+    uint64_t cycle_start;
+    uint64_t cycle_period;
+} SimStatus;
+
 void view_init(View* view, int nlines, int ncols, int begin_y, int begin_x)
 {
     assert(nlines + begin_y <= LINES);
@@ -41,50 +189,58 @@ void view_init(View* view, int nlines, int ncols, int begin_y, int begin_x)
     view->ncols = ncols;
     view->begin_x = begin_x;
     view->begin_y = begin_y;
+    view->top = 0;
+    view->left = 0;
+    view->zoom = 1;
+    view->render = RENDER_GRID;
 
 //    *view = (View){.nlines = nlines, .ncols = ncols, 
 //                    .begin_y = begin_y, .begin_x = begin_x};
 }
 
-// transforms model coords to view coords
-void model_to_view_coord(int *celly, int *cellx, View const *view)
+// characters down and across the view that show cells, inside the border
+// and, in grid mode, between the lines
+int view_glyph_rows(View const *view)
 {
-    *celly = (*celly) * 2 + 1 + view->begin_y;
-    *cellx = (*cellx) * 2 + 1 + view->begin_x;
+    return view->render == RENDER_GRID ? (view->nlines - 1) / 2 : view->nlines - 2;
 }
 
-// transforms view size to model size
-int view_to_model_size(int n)
+int view_glyph_cols(View const *view)
 {
-    return (n - 1) / 2;
+    return view->render == RENDER_GRID ? (view->ncols - 1) / 2 : view->ncols - 2;
 }
 
-void view_to_model_coord(int *y, int *x, View const *view)
+// shown cells down and across the view
+int view_rows(View const *view)
 {
-    *y = (*y - (1 + view->begin_y)) / 2;
-    *x = (*x - (1 + view->begin_x)) / 2;
+    return view_glyph_rows(view) * RENDER_ROWS[view->render];
 }
 
-void cell_move(int celly , int cellx, View const *view)
+int view_cols(View const *view)
 {
-    model_to_view_coord(&celly, &cellx, view);
-    move(celly, cellx);
+    return view_glyph_cols(view) * RENDER_COLS[view->render];
 }
 
-Model *model_new(View *view)
+// moves to the character in row gy, column gx of the view's characters
+void glyph_move(int gy, int gx, View const *view)
 {
-    Model *model = malloc(sizeof *model);
-    model->nrows = view_to_model_size(view->nlines);
-    model->ncols = view_to_model_size(view->ncols);
-    model->grid = calloc(model->nrows * model->ncols, sizeof *(model->grid));
+    int step = view->render == RENDER_GRID ? 2 : 1;
+    move(gy * step + 1 + view->begin_y, gx * step + 1 + view->begin_x);
+}
 
-    return model;
+// whether model cell (celly, cellx) is on screen
+bool view_contains(View const *view, int celly, int cellx)
+{
+    return celly >= view->top && cellx >= view->left
+        && (celly - view->top) / view->zoom < view_rows(view)
+        && (cellx - view->left) / view->zoom < view_cols(view);
 }
 
-void model_destroy(Model *model)
+// moves to the character showing model cell (celly, cellx)
+void cell_move(int celly , int cellx, View const *view)
 {
-    free(model->grid);
-    free(model);
+    glyph_move((celly - view->top) / view->zoom / RENDER_ROWS[view->render],
+            (cellx - view->left) / view->zoom / RENDER_COLS[view->render], view);
 }
 
 void clear_view(View *view)
@@ -113,6 +269,18 @@ void clear_view(View *view)
             else if (i == end_x - 1 && j == end_y - 1) {
                 addch(ACS_LRCORNER);
             }
+            // just the border around packed characters
+            else if (view->render != RENDER_GRID) {
+                if (i == begin_x || i == end_x - 1) {
+                    addch(ACS_VLINE);
+                }
+                else if (j == begin_y || j == end_y - 1) {
+                    addch(ACS_HLINE);
+                }
+                else {
+                    addch(' ');
+                }
+            }
             // tees for even edge poses
             else if (i == begin_x && j % 2 == 0) {
                 addch(ACS_LTEE);
@@ -145,90 +313,236 @@ void clear_view(View *view)
     }
 }
 
-void clear_model(View const *view, Model *model)
+// draws a character given which of its shown cells are alive, the cell at
+// row r, column c of the character being bit r * RENDER_COLS + c. the half
+// blocks and Braille patterns are written as UTF-8
+void put_glyph(Render render, unsigned glyph)
 {
-    int nrows = model->nrows;
-    int ncols = model->ncols;
+    static const char *const HALF_BLOCKS[] = {" ", "\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x88"};
 
-    for (int i = 0; i < ncols; i++) {
-        for (int j = 0; j < nrows; j++) {
-            cell_move(j, i, view);
-            model->grid[j * model->ncols + i] = 0;
-            addch(' ');
+    if (glyph == 0) {
+        addch(' ');
+        return;
+    }
+    switch (render)
+    {
+        case RENDER_GRID:
+            addch(ACS_BLOCK);
+            break;
+        case RENDER_HALF:
+            addstr(HALF_BLOCKS[glyph]);
+            break;
+        case RENDER_BRAILLE:
+        {
+            // U+2800 plus the dots
+            unsigned dots = 0;
+            for (int i = 0; i < 8; i++) {
+                if ((glyph >> i) & 1) {
+                    dots |= BRAILLE_DOTS[i];
+                }
+            }
+            char utf8[] = {(char) 0xe2, (char) (0xa0 | dots >> 6), (char) (0x80 | (dots & 0x3f)), '\0'};
+            addstr(utf8);
+            break;
         }
     }
 }
 
-// cell position corresponding to position of cursor in view
-void getyx_cell(int *celly_ptr, int *cellx_ptr, View* const view) {
-    int y, x;
-    getyx(stdscr, y, x);
+// which shown cells of the character in row gy, column gx are alive, as
+// put_glyph takes them
+unsigned view_glyph(View const *view, Model const *model, int gy, int gx)
+{
+    int rows = RENDER_ROWS[view->render];
+    int cols = RENDER_COLS[view->render];
+    unsigned glyph = 0;
+
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            if (model_block_alive(model, view->top + (gy * rows + r) * view->zoom,
+                        view->left + (gx * cols + c) * view->zoom, view->zoom))
+            {
+                glyph |= 1u << (r * cols + c);
+            }
+        }
+    }
+    return glyph;
+}
 
-    view_to_model_coord(&y, &x, view);
-    *celly_ptr = y;
-    *cellx_ptr = x;
+void draw_view(View *view, Model const *model)
+{
+    for (int gy = 0; gy < view_glyph_rows(view); gy++) {
+        for (int gx = 0; gx < view_glyph_cols(view); gx++) {
+            glyph_move(gy, gx, view);
+            put_glyph(view->render, view_glyph(view, model, gy, gx));
+        }
+    }
 }
 
-void toggle_fill(View *view, Model *model)
+// redraws the character showing model cell (celly, cellx)
+void draw_cell(View *view, Model const *model, int celly, int cellx)
 {
-    int celly, cellx;
+    int gy = (celly - view->top) / view->zoom / RENDER_ROWS[view->render];
+    int gx = (cellx - view->left) / view->zoom / RENDER_COLS[view->render];
 
-    getyx_cell(&celly, &cellx, view);
+    glyph_move(gy, gx, view);
+    put_glyph(view->render, view_glyph(view, model, gy, gx));
+}
 
-    if (model->grid[celly * model->ncols + cellx] == 0) 
-    {
-        model->grid[celly * model->ncols + cellx] = 1;
-        addch(ACS_BLOCK);
+void clear_model(View const *view, Model *model)
+{
+    model_clear(model);
+    for (int gy = 0; gy < view_glyph_rows(view); gy++) {
+        for (int gx = 0; gx < view_glyph_cols(view); gx++) {
+            glyph_move(gy, gx, view);
+            addch(' ');
+        }
     }
-    else
-    {
-        model->grid[celly * model->ncols + cellx] = 0;
-        addch(' ');
+}
+
+void toggle_fill(View *view, Model *model, int celly, int cellx)
+{
+    // a zoomed out cell stands for many model cells
+    if (view->zoom != 1) {
+        return;
     }
+
+    model_set(model, celly, cellx, !model_get(model, celly, cellx));
+    draw_cell(view, model, celly, cellx);
 }
 
-void random_fill(int chance, View *view, Model *model)
+// fills the whole of a bounded grid, or what is on screen of an unbounded
+// universe
+void random_fill(int chance, View *view, Model *model, Rng *rng)
 {
+    int top = 0;
+    int left = 0;
     int nrows = model->nrows;
     int ncols = model->ncols;
 
-    for (int i = 0; i < ncols; i++) {
-        for (int j = 0; j < nrows; j++) {
-            cell_move(j, i, view);
-            int n = rand() % 100;
+    if (model->universe) {
+        top = view->top;
+        left = view->left;
+        nrows = view_rows(view) * view->zoom;
+        ncols = view_cols(view) * view->zoom;
+    }
 
-            if (n < chance)
-            {
-                addch(ACS_BLOCK);
-                model->grid[j * ncols + i] = 1;
+    model_random_fill(model, chance, top, left, nrows, ncols, rng);
+    draw_view(view, model);
+}
+
+// keeps a bounded grid's edges from being panned past
+void view_clamp(View *view, Model const *model)
+{
+    if (model->universe) {
+        return;
+    }
+
+    int nrows = view_rows(view) * view->zoom;
+    int ncols = view_cols(view) * view->zoom;
+    int max_top = model->nrows > nrows ? model->nrows - nrows : 0;
+    int max_left = model->ncols > ncols ? model->ncols - ncols : 0;
+
+    view->top = view->top < 0 ? 0 : view->top > max_top ? max_top : view->top;
+    view->left = view->left < 0 ? 0 : view->left > max_left ? max_left : view->left;
+}
+
+// pans by half a screen on w/a/s/d and zooms on +/-, returning whether ch
+// was one of those keys
+bool view_key(View *view, Model const *model, int ch)
+{
+    int nrows = view_rows(view) * view->zoom;
+    int ncols = view_cols(view) * view->zoom;
+
+    switch (ch)
+    {
+        case 'w':
+            view->top -= nrows / 2;
+            break;
+        case 's':
+            view->top += nrows / 2;
+            break;
+        case 'a':
+            view->left -= ncols / 2;
+            break;
+        case 'd':
+            view->left += ncols / 2;
+            break;
+        case '+':
+        case '=':
+            if (view->zoom > 1) {
+                view->zoom /= 2;
             }
-            else 
-            {
-                addch(' ');
-                model->grid[j * ncols + i] = 0;
+            break;
+        case '-':
+            if (view->zoom < MAX_ZOOM) {
+                view->zoom *= 2;
             }
-            // o/w blank
-        }
+            break;
+        default:
+            return false;
     }
+
+    view_clamp(view, model);
+    return true;
 }
 
-State user_fill_grid(View *view, Model *model)
+// switches to the next render mode and redraws the view for it
+void view_cycle_render(View *view, Model const *model)
+{
+    int nrenders = sizeof RENDER_NAMES / sizeof *RENDER_NAMES;
+    view->render = (Render) ((view->render + 1) % nrenders);
+    view_clamp(view, model);
+    clear_view(view);
+    draw_view(view, model);
+}
+
+void print_fill_status(int chance, unsigned seed, View const *view)
+{
+    move(1, 0);
+    clrtoeol();
+    printw("Fill Chance: %d%% | Seed: %u | View: (%d, %d) 1:%d %s", chance, seed,
+            view->top, view->left, view->zoom, RENDER_NAMES[view->render]);
+}
+
+// reads a file path on the status row, false if none was entered
+bool prompt_path(char const *prompt, char *path, int size)
+{
+    move(1, 0);
+    clrtoeol();
+    printw("%s", prompt);
+    echo();
+    int rc = getnstr(path, size - 1);
+    noecho();
+
+    return rc == OK && path[0] != '\0';
+}
+
+void print_file_error(char const *what, char const *path)
 {
-    static int chance = INIT_CHANCE;
     move(1, 0);
     clrtoeol();
-    printw("Fill Chance: %d%%", chance);
+    printw("%s %s: %s", what, path, strerror(errno));
+}
+
+// random fill i is seeded with seed + i, nfills counting the fills so far,
+// and the status shows the seed of the last (or the first to come), so a
+// fill can be redrawn by passing its seed to --seed
+State user_fill_grid(View *view, Model *model, unsigned seed, unsigned *nfills)
+{
+    static int chance = INIT_CHANCE;
+    unsigned shown = seed + (*nfills > 0 ? *nfills - 1 : 0);
+    print_fill_status(chance, shown, view);
 
     move(0, 0);
     clrtoeol();
-    printw("Arrow keys = move | r = run | f = fill | x = -5%% | c = +5%% | v = random | F1 = exit");
-    cell_move(0, 0, view);
+    printw("Arrow keys = move | r = run | f = fill | x = -5%% | c = +5%% | v = random | wasd = pan | +/- = zoom | m = render | i/o = import/export | F1 = exit");
+    cell_move(view->top, view->left, view);
     curs_set(1);
     timeout(-1);
 
-    int cellx = 0;
-    int celly = 0;
-
+    int cellx = view->left;
+    int celly = view->top;
+    char path[PATH_MAX];
 
     int ch;
     while ((ch = getch()))
@@ -236,57 +550,102 @@ State user_fill_grid(View *view, Model *model)
         switch (ch) 
         {
             case KEY_RIGHT:
-                if (cellx + 1 < model->ncols)
+                if (view_contains(view, celly, cellx + view->zoom)
+                    && model_contains(model, celly, cellx + view->zoom))
                 {
-                    cellx += 1;
+                    cellx += view->zoom;
                 }
                 break;
             case KEY_UP:
-                if (celly - 1 >= 0)
+                if (view_contains(view, celly - view->zoom, cellx)
+                    && model_contains(model, celly - view->zoom, cellx))
                 {
-                    celly -= 1;
+                    celly -= view->zoom;
                 }
                 break;
             case KEY_DOWN:
-                if (celly + 1 < model->nrows)
+                if (view_contains(view, celly + view->zoom, cellx)
+                    && model_contains(model, celly + view->zoom, cellx))
                 {
-                    celly += 1;
+                    celly += view->zoom;
                 }
                 break;
             case KEY_LEFT:
-                if (cellx - 1 >= 0)
+                if (view_contains(view, celly, cellx - view->zoom)
+                    && model_contains(model, celly, cellx - view->zoom))
                 {
-                    cellx -= 1;
+                    cellx -= view->zoom;
                 }
                 break;
             case 'f':
-                toggle_fill(view, model);
+                toggle_fill(view, model, celly, cellx);
                 break;
             case 'v':
-                random_fill(chance, view, model);
+            {
+                Rng rng;
+                rng_seed(&rng, seed + *nfills);
+                random_fill(chance, view, model, &rng);
+                shown = seed + (*nfills)++;
+                print_fill_status(chance, shown, view);
                 break;
+            }
             case 'c':
                 if (chance + 5 <= 100)
                 {
                     chance += 5;
-                    move(1, 0);
-                    clrtoeol();
-                    printw("Fill Chance: %d%%", chance);
+                    print_fill_status(chance, shown, view);
                 }
                 break;
             case 'x':
                 if (chance - 5 >= 0)
                 {
                     chance -= 5;
-                    move(1, 0);
-                    clrtoeol();
-                    printw("Fill Chance: %d%%", chance);
+                    print_fill_status(chance, shown, view);
+                }
+                break;
+            case 'i':
+                if (prompt_path("Import pattern at cursor: ", path, sizeof path))
+                {
+                    // a pattern that fails partway has still set some cells
+                    bool loaded = pattern_load(model, path, celly, cellx);
+                    int err = errno;
+                    draw_view(view, model);
+                    if (!loaded) {
+                        errno = err;
+                        print_file_error("cannot import", path);
+                        break;
+                    }
                 }
+                print_fill_status(chance, shown, view);
+                break;
+            case 'o':
+                if (prompt_path("Export pattern to: ", path, sizeof path)
+                    && !pattern_save(model, path))
+                {
+                    print_file_error("cannot export", path);
+                    break;
+                }
+                print_fill_status(chance, shown, view);
+                break;
+            case 'm':
+                view_cycle_render(view, model);
+                print_fill_status(chance, shown, view);
+                celly = view->top;
+                cellx = view->left;
                 break;
             case 'r':
                 return PROCEED;
             case KEY_F(1):
                 return EXIT;
+            default:
+                if (view_key(view, model, ch))
+                {
+                    draw_view(view, model);
+                    print_fill_status(chance, shown, view);
+                    celly = view->top;
+                    cellx = view->left;
+                }
+                break;
         }
         cell_move(celly, cellx, view);
         refresh();
@@ -295,145 +654,1118 @@ State user_fill_grid(View *view, Model *model)
     return EXIT;
 }
 
-void draw_view(View *view, Model const *model)
+void sleep_ms(double ms)
 {
-    int nrows = model->nrows;
-    int ncols = model->ncols;
+    struct timespec ts = {
+        .tv_sec = (time_t) (ms / 1e3),
+        .tv_nsec = (long) ((ms - (time_t) (ms / 1e3) * 1e3) * 1e6),
+    };
+    nanosleep(&ts, NULL);
+}
 
-    for (int i = 0; i < ncols; i++) {
-        for (int j = 0; j < nrows; j++) {
-            cell_move(j, i, view);
-            if (model->grid[j * model->ncols + i] == 1)
-            {
-                addch(ACS_BLOCK);
-            }
-            else 
-            {
-                addch(' ');
-            }
-            // o/w blank
-        }
+void timing_add(Timing *timing, double ms)
+{
+    timing->samples[timing->count++ % TIMING_SAMPLES] = ms;
+}
+
+int compare_doubles(void const *a, void const *b)
+{
+    double x = *(double const *) a;
+    double y = *(double const *) b;
+    return (x > y) - (x < y);
+}
+
+// mean and 99th percentile (nearest rank) of the samples held
+void timing_stats(Timing const *timing, double *avg, double *p99)
+{
+    int n = timing->count < TIMING_SAMPLES ? (int) timing->count : TIMING_SAMPLES;
+    if (n == 0) {
+        *avg = 0;
+        *p99 = 0;
+        return;
+    }
+
+    double sorted[TIMING_SAMPLES];
+    memcpy(sorted, timing->samples, (size_t) n * sizeof *sorted);
+    qsort(sorted, (size_t) n, sizeof *sorted, compare_doubles);
+
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += sorted[i];
     }
+    *avg = sum / n;
+    *p99 = sorted[(n * 99 + 99) / 100 - 1];
 }
 
-bool out_of_bounds(int celly, int cellx, Model const *model) {
+Frame *frame_new(View const *view)
+{
+    Frame *frame = malloc(sizeof *frame);
+    frame->nrows = view_glyph_rows(view);
+    frame->ncols = view_glyph_cols(view);
+    frame->glyphs = malloc((size_t) frame->nrows * frame->ncols);
+    frame->nwords = (view_cols(view) + 63) / 64;
+    frame->rows = malloc((size_t) RENDER_ROWS[view->render] * frame->nwords * sizeof(uint64_t));
 
-    return celly < 0 || celly >= model->nrows
-            || cellx < 0 || cellx >= model->ncols;
+    return frame;
 }
-int num_neighbors(int celly, int cellx, Model const *model) {
 
-    int count = 0;
-    for (int i = -1; i <= 1; i++)
+void frame_destroy(Frame *frame)
+{
+    free(frame->glyphs);
+    free(frame->rows);
+    free(frame);
+}
+
+// the shown cells of row j of the view into bits, leftmost lowest. unless
+// zoomed out they are the model's words, realigned to the view
+void view_row_bits(View const *view, Model const *model, int j, uint64_t *bits, int nwords)
+{
+    int y = view->top + j * view->zoom;
+
+    if (view->zoom > 1)
     {
-        for (int j = -1; j <= 1; j++) 
-        {
-            // ignore the node itself
-            if (!((i == 0 && j == 0) 
-                || out_of_bounds(celly + j, cellx + i, model))
-                && model->grid[(celly + j) * model->ncols + (cellx + i)] == 1)
-            {
-                count++;
+        memset(bits, 0, (size_t) nwords * sizeof *bits);
+        for (int i = 0; i < view_cols(view); i++) {
+            if (model_block_alive(model, y, view->left + i * view->zoom, view->zoom)) {
+                bits[i / 64] |= UINT64_C(1) << (i % 64);
             }
         }
+        return;
     }
 
-
-    return count;
+    int x = floor_div(view->left, 64) * 64;
+    int shift = view->left - x;
+    uint64_t word = model_word(model, y, x);
+    for (int w = 0; w < nwords; w++)
+    {
+        uint64_t next = model_word(model, y, x + (w + 1) * 64);
+        bits[w] = shift == 0 ? word : (word >> shift) | (next << (64 - shift));
+        word = next;
+    }
 }
 
-void single_turn(View *view, Model* model)
+// records what each character of the view would display
+void frame_sample(Frame *frame, View const *view, Model const *model)
 {
-    int *temp = calloc(model->ncols * model->nrows, sizeof *temp);
+    int rows = RENDER_ROWS[view->render];
+    int cols = RENDER_COLS[view->render];
 
-    for (int i = 0; i < model->ncols; i++)
+    for (int gy = 0; gy < frame->nrows; gy++)
     {
-        for (int j = 0; j < model->nrows; j++)
-        {
-            int n = num_neighbors(j, i, model);
+        for (int r = 0; r < rows; r++) {
+            view_row_bits(view, model, gy * rows + r, &frame->rows[r * frame->nwords],
+                    frame->nwords);
+        }
 
-            // populated
-            if ((model->grid[j * model->ncols + i] == 1)
-                && (n == 2 || n == 3))
-            {
-                temp[j * model->ncols + i] = 1;
-            }
-            // unpopulated
-            else if ((model->grid[j * model->ncols + i] == 0)
-                && (n == 3))
+        for (int gx = 0; gx < frame->ncols; gx++)
+        {
+            unsigned glyph = 0;
+            for (int r = 0; r < rows; r++)
             {
-                temp[j * model->ncols + i] = 1;
+                uint64_t const *bits = &frame->rows[r * frame->nwords];
+                for (int c = 0; c < cols; c++)
+                {
+                    int i = gx * cols + c;
+                    glyph |= (unsigned) ((bits[i / 64] >> (i % 64)) & 1) << (r * cols + c);
+                }
             }
-            // o/w empty or dead
+            frame->glyphs[gy * frame->ncols + gx] = (unsigned char) glyph;
         }
     }
+}
 
-    // copy temp
-    for (int i = 0; i < model->ncols; i++)
+// draws the characters of frame that differ from what shown has on screen
+void frame_draw(Frame const *frame, Frame const *shown, View const *view)
+{
+    for (int gy = 0; gy < frame->nrows; gy++)
     {
-        for (int j = 0; j < model->nrows; j++)
+        for (int gx = 0; gx < frame->ncols; gx++)
         {
-            model->grid[j * model->ncols + i] = temp[j * model->ncols + i];
+            unsigned char glyph = frame->glyphs[gy * frame->ncols + gx];
+            if (glyph == shown->glyphs[gy * frame->ncols + gx]) {
+                continue;
+            }
+            glyph_move(gy, gx, view);
+            put_glyph(view->render, glyph);
         }
     }
-    free(temp);
-    draw_view(view, model);
 }
 
-State simulate(View *view, Model *model)
+// once the board is known to repeat, the generations up to the target
+// are skipped arithmetically and only the remainder modulo the period is
+// stepped (to within a step, for hashlife)
+void sim_fast_forward(Sim *sim)
+{
+    Model *model = sim->model;
+    uint64_t step = model_step_size(model);
+    uint64_t remaining = (sim->target - model->generation) % sim->cycle_period;
+    uint64_t skipped = sim->target - model->generation - remaining;
+
+    for (; remaining >= step; remaining -= step) {
+        model_step(model);
+    }
+    model->generation += skipped;
+}
+
+// checks a new generation for a repeat and for the target, pausing as
+// configured
+void sim_check(Sim *sim)
+{
+    Model *model = sim->model;
+
+    if (!sim->cycle_found
+        && history_repeat(&sim->history, model->hash, model->generation, &sim->cycle_start))
+    {
+        sim->cycle_found = true;
+        sim->cycle_period = model->generation - sim->cycle_start;
+        if (sim->on_cycle == ON_CYCLE_FFWD && sim->target > model->generation) {
+            sim_fast_forward(sim);
+        }
+        if (sim->on_cycle != ON_CYCLE_REPORT) {
+            sim->paused = true;
+        }
+    }
+    if (sim->target > 0 && model->generation >= sim->target) {
+        sim->target = 0;
+        sim->paused = true;
+    }
+}
+
+// steps the model a generation, timed, checked and checkpointed
+void sim_step(Sim *sim)
+{
+    double start = now_ms();
+    model_step(sim->model);
+    double ms = now_ms() - start;
+    timing_add(&sim->step_timing, ms);
+    if (sim->timings) {
+        fprintf(sim->timings, "step,%llu,%.6f\n",
+                (unsigned long long) sim->model->generation, ms);
+    }
+    sim_check(sim);
+    if (sim->timeline) {
+        timeline_record(sim->timeline, sim->model);
+    }
+}
+
+// takes the model back to an earlier generation (as far as the timeline
+// reaches) by restoring the checkpoint before it and stepping from there.
+// past the start of a known cycle only the remainder modulo the period is
+// stepped, which also covers generations fast-forwarded over
+void sim_seek(Sim *sim, uint64_t generation)
+{
+    Model *model = sim->model;
+    // with no checkpoint, as when a keyframe of the grid doesn't fit the
+    // history, there is nothing to go back to
+    if (!sim->timeline || sim->timeline->count == 0 || generation >= model->generation) {
+        return;
+    }
+    if (generation < timeline_start(sim->timeline)) {
+        generation = timeline_start(sim->timeline);
+    }
+    if (!timeline_restore(sim->timeline, model, generation)) {
+        return;
+    }
+
+    uint64_t steps = generation - model->generation;
+    if (sim->cycle_found && generation >= sim->cycle_start)
+    {
+        uint64_t lead = model->generation < sim->cycle_start
+            ? sim->cycle_start - model->generation
+            : 0;
+        steps = lead + (steps - lead) % sim->cycle_period;
+    }
+    uint64_t skipped = generation - model->generation - steps;
+    uint64_t step = model_step_size(model);
+    for (; steps >= step; steps -= step) {
+        model_step(model);
+    }
+    model->generation += skipped;
+
+    // generations about to be stepped again are not repeats
+    history_clear(&sim->history);
+    history_repeat(&sim->history, model->hash, model->generation, &sim->cycle_start);
+}
+
+void *sim_run(void *arg)
+{
+    Sim *sim = arg;
+
+    pthread_mutex_lock(&sim->lock);
+    while (!sim->quit)
+    {
+        // hand the lock over when the UI is waiting to sample, so a fast
+        // step loop can't starve it
+        if (sim->paused || atomic_load(&sim->sample_wanted)) {
+            pthread_cond_wait(&sim->wake, &sim->lock);
+            continue;
+        }
+
+        sim_step(sim);
+
+        double delay = sim->delay;
+        if (delay > 0) {
+            pthread_mutex_unlock(&sim->lock);
+            sleep_ms(delay);
+            pthread_mutex_lock(&sim->lock);
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    return NULL;
+}
+
+// locks the model away from the sim thread
+void sim_lock(Sim *sim)
+{
+    atomic_store(&sim->sample_wanted, true);
+    pthread_mutex_lock(&sim->lock);
+}
+
+void sim_unlock(Sim *sim)
+{
+    atomic_store(&sim->sample_wanted, false);
+    pthread_cond_signal(&sim->wake);
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void sim_start(Sim *sim, Model *model, double delay, Options const *opts, FILE *timings,
+        Timeline *timeline)
+{
+    sim->model = model;
+    sim->delay = delay;
+    sim->paused = false;
+    sim->quit = false;
+    sim->on_cycle = opts->on_cycle;
+    sim->target = opts->target > model->generation ? opts->target : 0;
+    sim->cycle_found = false;
+    sim->step_timing.count = 0;
+    sim->timings = timings;
+    sim->timeline = timeline;
+    history_clear(&sim->history);
+    history_repeat(&sim->history, model->hash, model->generation, &sim->cycle_start);
+    if (timeline) {
+        timeline_clear(timeline);
+        timeline_record(timeline, model);
+    }
+
+    atomic_init(&sim->sample_wanted, false);
+    pthread_mutex_init(&sim->lock, NULL);
+    pthread_cond_init(&sim->wake, NULL);
+    pthread_create(&sim->thread, NULL, sim_run, sim);
+}
+
+void sim_stop(Sim *sim)
+{
+    sim_lock(sim);
+    sim->quit = true;
+    sim_unlock(sim);
+
+    pthread_join(sim->thread, NULL);
+    pthread_cond_destroy(&sim->wake);
+    pthread_mutex_destroy(&sim->lock);
+}
+
+void print_status(double delay, double gen_rate, double fps, View const *view,
+        SimStatus const *status)
+{
+    move(1, 0);
+    clrtoeol();
+    printw("Delay: %.2fms | Generation: %llu | %.0f gen/s | %.0f fps | View: (%d, %d) 1:%d %s",
+            delay, (unsigned long long) status->generation, gen_rate, fps,
+            view->top, view->left, view->zoom, RENDER_NAMES[view->render]);
+    if (status->cycle_found) {
+        printw(" | Period %llu from %llu", (unsigned long long) status->cycle_period,
+                (unsigned long long) status->cycle_start);
+    }
+    if (status->paused) {
+        printw(" | Paused");
+    }
+}
+
+void print_keys(void)
+{
+    move(0, 0);
+    clrtoeol();
+    printw("UP = x2 delay | DOWN = x0.5 delay | p = pause | ,/. = step back/forward | r = rewind | wasd = pan | +/- = zoom | m = render | t = timings | e = end | F1 = exit");
+}
+
+// rolling timings of the last TIMING_SAMPLES steps and frames, in place of
+// the key help. wait is how long frames waited for the sim thread to finish
+// a step before they could render
+void print_timings(Timing const *step, Timing const *wait, Timing const *render,
+        Timing const *flush)
 {
+    Timing const *phases[] = {step, wait, render, flush};
+    char const *names[] = {"Step", "Wait", "Render", "Flush"};
+
     move(0, 0);
     clrtoeol();
-    printw("UP = x2 delay | DOWN = x0.5 delay | e = end | F1 = exit");
+    for (int i = 0; i < 4; i++)
+    {
+        double avg;
+        double p99;
+        timing_stats(phases[i], &avg, &p99);
+        printw("%s: %.3fms avg %.3fms p99 | ", names[i], avg, p99);
+    }
+    printw("t = keys");
+}
+
+// the model steps on its own thread as fast as the delay allows, while the
+// screen shows the latest generation at up to fps frames a second. frames
+// the terminal can't keep up with are dropped rather than slowing the
+// simulation down. step, wait, render and terminal flush times are kept for
+// the timings overlay, and written per generation (or frame) to timings if
+// set.
+// the timeline, if any, is checkpointed from the start so the run can be
+// stepped back through and rewound
+State simulate(View *view, Model *model, Options const *opts, FILE *timings,
+        Timeline *timeline)
+{
+    static bool show_timings = false;
+    if (!show_timings) {
+        print_keys();
+    }
 
     curs_set(0);
     timeout(0);
 
     static double delay = INIT_DELAY;
 
-    move(1, 0);
-    clrtoeol();
-    printw("Delay: %.2fms", delay);
+    model_invalidate(model);
+    draw_view(view, model);
 
-    int ch;
-    while ((ch = getch()))
-    {
-        single_turn(view, model);
+    Frame *shown = frame_new(view);
+    Frame *frame = frame_new(view);
+    frame_sample(shown, view, model);
+
+    Sim sim;
+    sim_start(&sim, model, delay, opts, timings, timeline);
+    Timing step_timing = {.count = 0};
+    Timing wait_timing = {.count = 0};
+    Timing render_timing = {.count = 0};
+    Timing flush_timing = {.count = 0};
 
+    double frame_ms = 1e3 / opts->fps;
+    double next_frame = now_ms();
+    // rates are measured over windows of about half a second
+    double window_start = next_frame;
+    uint64_t window_generation = model->generation;
+    int window_frames = 0;
+    double gen_rate = 0;
+    double frame_rate = 0;
+    SimStatus status = {.generation = model->generation};
 
+    State state = EXIT;
+    bool running = true;
+    while (running)
+    {
+        int ch = getch();
         switch (ch) {
+            case ERR:
+                break;
             case 'e':
-                return PROCEED;
-
+                state = PROCEED;
+                running = false;
+                break;
             case KEY_F(1):
-                return EXIT;
+                running = false;
+                break;
             case KEY_UP:
-                delay *= 2;
-
-                move(1, 0);
-                clrtoeol();
-                printw("Delay: %.2fms", delay);
+                delay = delay > 0 ? delay * 2 : 1;
                 break;
             case KEY_DOWN:
-                delay /= 2;
-
-                move(1, 0);
-                clrtoeol();
-                printw("Delay: %.2fms", delay);
+                // below a millisecond, run flat out
+                delay = delay > 1 ? delay / 2 : 0;
+                break;
+            case 'p':
+                sim_lock(&sim);
+                sim.paused = !sim.paused;
+                sim_unlock(&sim);
+                break;
+            case ',':
+                sim_lock(&sim);
+                sim.paused = true;
+                sim_seek(&sim, model->generation - model_step_size(model));
+                sim_unlock(&sim);
+                break;
+            case '.':
+                sim_lock(&sim);
+                sim.paused = true;
+                sim_step(&sim);
+                sim_unlock(&sim);
+                break;
+            case 'r':
+                sim_lock(&sim);
+                sim.paused = true;
+                sim_seek(&sim, 0);
+                sim_unlock(&sim);
                 break;
+            case 'm':
+                sim_lock(&sim);
+                view_cycle_render(view, model);
+                frame_destroy(shown);
+                frame_destroy(frame);
+                shown = frame_new(view);
+                frame = frame_new(view);
+                frame_sample(shown, view, model);
+                sim_unlock(&sim);
+                break;
+            case 't':
+                show_timings = !show_timings;
+                if (!show_timings) {
+                    print_keys();
+                }
+                break;
+            default:
+                sim_lock(&sim);
+                view_key(view, model, ch);
+                sim_unlock(&sim);
+                break;
+        }
+        if (ch != ERR) {
+            // drain queued keys before drawing
+            continue;
+        }
+
+        double now = now_ms();
+        if (now < next_frame) {
+            sleep_ms(next_frame - now < 5 ? next_frame - now : 5);
+            continue;
         }
+        next_frame = now + frame_ms;
+
+        // the render is timed from when the sim thread lets go, so a slow
+        // step shows up as wait rather than render
+        sim_lock(&sim);
+        double render_start = now_ms();
+        sim.delay = delay;
+        frame_sample(frame, view, model);
+        if (show_timings) {
+            step_timing = sim.step_timing;
+        }
+        status = (SimStatus){
+            .generation = model->generation,
+            .paused = sim.paused,
+            .cycle_found = sim.cycle_found,
+            .cycle_start = sim.cycle_start,
+            .cycle_period = sim.cycle_period,
+        };
+        sim_unlock(&sim);
+
+        frame_draw(frame, shown, view);
+        Frame *tmp = shown;
+        shown = frame;
+        frame = tmp;
+        window_frames++;
+
+        if (now - window_start >= 500)
+        {
+            gen_rate = (status.generation - window_generation) * 1e3 / (now - window_start);
+            frame_rate = window_frames * 1e3 / (now - window_start);
+            window_start = now;
+            window_generation = status.generation;
+            window_frames = 0;
+        }
+        print_status(delay, gen_rate, frame_rate, view, &status);
+        if (show_timings) {
+            print_timings(&step_timing, &wait_timing, &render_timing, &flush_timing);
+        }
+
+        double flush_start = now_ms();
         refresh();
-        napms((int) delay);
+        double flush_end = now_ms();
+
+        timing_add(&wait_timing, render_start - now);
+        timing_add(&render_timing, flush_start - render_start);
+        timing_add(&flush_timing, flush_end - flush_start);
+        if (timings) {
+            fprintf(timings, "wait,%llu,%.6f\nrender,%llu,%.6f\nflush,%llu,%.6f\n",
+                    (unsigned long long) status.generation, render_start - now,
+                    (unsigned long long) status.generation, flush_start - render_start,
+                    (unsigned long long) status.generation, flush_end - flush_start);
+        }
     }
 
-    return EXIT;
+    sim_stop(&sim);
+    frame_destroy(frame);
+    frame_destroy(shown);
+
+    return state;
+}
+
+// runs random soups without a terminal, one per worker thread at a time
+typedef struct Ensemble{
+    Options const *opts;
+    atomic_long next_soup;
+    // serializes result lines and the count of soups done
+    pthread_mutex_t lock;
+    long ndone;
+} Ensemble;
+
+typedef struct SoupResult{
+    unsigned seed;
+    uint64_t population;
+    // first generation of the cycle the soup settled into and its period,
+    // or the generation given up at and 0
+    uint64_t generation;
+    uint64_t period;
+} SoupResult;
+
+// steps a soup until a generation repeats an earlier one
+void run_soup(Model *model, Options const *opts, unsigned seed, SoupResult *result)
+{
+    History history;
+    history_clear(&history);
+
+    model_clear(model);
+    Rng rng;
+    rng_seed(&rng, seed);
+    model_random_fill(model, opts->chance, 0, 0, opts->soup_rows, opts->soup_cols, &rng);
+    model_invalidate(model);
+
+    *result = (SoupResult){.seed = seed};
+    while (true)
+    {
+        uint64_t start;
+        if (history_repeat(&history, model->hash, model->generation, &start)) {
+            result->generation = start;
+            result->period = model->generation - start;
+            break;
+        }
+        if (model->generation >= opts->max_generations) {
+            result->generation = model->generation;
+            break;
+        }
+        model_step(model);
+    }
+    result->population = model_population(model);
+}
+
+void print_soup(Options const *opts, SoupResult const *result)
+{
+    if (opts->format == OUTPUT_JSON) {
+        printf("{\"seed\": %u, \"population\": %llu, \"generation\": %llu, \"period\": %llu}\n",
+                result->seed, (unsigned long long) result->population,
+                (unsigned long long) result->generation, (unsigned long long) result->period);
+    }
+    else {
+        printf("%u,%llu,%llu,%llu\n", result->seed,
+                (unsigned long long) result->population,
+                (unsigned long long) result->generation, (unsigned long long) result->period);
+    }
+}
+
+void *ensemble_worker(void *arg)
+{
+    Ensemble *ens = arg;
+    Options const *opts = ens->opts;
+
+    // the threads run soups side by side, so each steps on its own
+    Model *model = model_new(&(ModelConfig){
+        .nrows = opts->soup_rows,
+        .ncols = opts->soup_cols,
+        .engine = opts->engine,
+        .rule = opts->rule,
+        .boundary = opts->boundary,
+        .nthreads = 1,
+        .hashlife_nodes = opts->hashlife_nodes,
+        .step_exp = opts->step_exp,
+    });
+
+    long soup;
+    while ((soup = atomic_fetch_add(&ens->next_soup, 1)) < opts->soups)
+    {
+        SoupResult result;
+        run_soup(model, opts, opts->seed + (unsigned) soup, &result);
+
+        pthread_mutex_lock(&ens->lock);
+        print_soup(opts, &result);
+        ens->ndone++;
+        pthread_mutex_unlock(&ens->lock);
+    }
+
+    model_destroy(model);
+    return NULL;
+}
+
+// runs opts->soups soups on opts->nthreads threads, streaming one result
+// line per soup to stdout as it finishes, then reports the throughput on
+// stderr. soup i is seeded with seed + i, so any soup can be rerun alone
+int run_ensemble(char const *prog, Options const *opts)
+{
+    Ensemble ens = {.opts = opts, .ndone = 0};
+    atomic_init(&ens.next_soup, 0);
+    pthread_mutex_init(&ens.lock, NULL);
+
+    if (opts->format == OUTPUT_CSV) {
+        puts("seed,population,generation,period");
+    }
+
+    double start = now_ms();
+    pthread_t *threads = malloc((size_t) opts->nthreads * sizeof *threads);
+    for (int i = 1; i < opts->nthreads; i++) {
+        pthread_create(&threads[i], NULL, ensemble_worker, &ens);
+    }
+    ensemble_worker(&ens);
+    for (int i = 1; i < opts->nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = (now_ms() - start) / 1e3;
+
+    free(threads);
+    pthread_mutex_destroy(&ens.lock);
+    fflush(stdout);
+    fprintf(stderr, "%s: %ld soups in %.3fs, %.1f soups/s\n", prog, ens.ndone,
+            elapsed, elapsed > 0 ? ens.ndone / elapsed : 0.0);
+
+    return ferror(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void usage(char const *prog)
+{
+    fprintf(stderr, "usage: %s [--engine scalar|packed|active|hashlife] [--threads N]\n"
+            "       [--size ROWSxCOLS | --unbounded] [--step-exp K] [--hashlife-nodes N]\n"
+            "       [--load FILE] [--save FILE] [--fps N]\n"
+            "       [--on-cycle report|pause|ffwd] [--generations G] [--rule B3/S23]\n"
+            "       [--boundary dead|torus|mirror] [--timings FILE]\n"
+            "       [--history-size MB] [--history-file FILE]\n"
+            "       [--render grid|half|braille] [--seed S]\n"
+            "       [--soups N [--chance P] [--format csv|json]\n"
+            "        [--max-generations G]]\n"
+            "  --engine E          scalar: one cell at a time, packed: 64 cells per\n"
+            "                      word, active: packed, skipping tiles that have\n"
+            "                      settled, hashlife: memoized quadtree over an\n"
+            "                      unbounded universe the grid is a window onto\n"
+            "  --size ROWSxCOLS    grid size (default: fit the terminal)\n"
+            "  --unbounded         no grid edges; cells are kept in 64x64 tiles that\n"
+            "                      follow the pattern, stepped by the packed kernel,\n"
+            "                      or in hashlife's quadtree\n"
+            "  --threads N         step the packed engines on N threads, 0 for one\n"
+            "                      per CPU (default: $LIFE_THREADS or 1)\n"
+            "  --step-exp K        hashlife advances 2^K generations per step\n"
+            "  --hashlife-nodes N  hashlife node cache cap (default %zu)\n"
+            "  --load FILE         start with an RLE or plaintext (.cells, .txt)\n"
+            "                      pattern at the top left; the rule in an RLE\n"
+            "                      header, as for 'i', replaces --rule\n"
+            "  --save FILE         write the board to a pattern file at exit\n"
+            "  --fps N             redraw at most N times a second while running;\n"
+            "                      the simulation itself is not held back (default %d)\n"
+            "  --on-cycle A        once the board repeats itself, report the period\n"
+            "                      (default), pause, or fast-forward to --generations\n"
+            "  --generations G     pause on reaching generation G\n"
+            "  --rule R            outer totalistic rule as Bx/Sy (or the older\n"
+            "                      y/x), e.g. B36/S23; B0 rules are not supported\n"
+            "  --boundary B        past the grid edges: dead cells (default), the\n"
+            "                      opposite edge (torus) or the edge reflected\n"
+            "                      (mirror). bounded grids and the packed, active\n"
+            "                      and scalar engines only\n"
+            "  --timings FILE      write the time of every step, wait for the step\n"
+            "                      to finish, render and terminal flush to FILE as\n"
+            "                      CSV (phase,generation,ms); 't' shows rolling\n"
+            "                      averages while running\n"
+            "  --history-size MB   keep up to MB megabytes of checkpoints to step\n"
+            "                      back through and rewind, dropping the oldest\n"
+            "                      (default %ld, 0 for none). bounded grids and the\n"
+            "                      packed, active and scalar engines only\n"
+            "  --history-file FILE keep the checkpoints in FILE, mapped into memory\n"
+            "  --render R          draw each cell with grid lines (default), or pack\n"
+            "                      1x2 cells into half block or 2x4 into Braille\n"
+            "                      characters (needs a UTF-8 terminal); 'm' switches\n"
+            "  --soups N           headless: run N random soups (--size or %dx%d,\n"
+            "                      --threads at a time, never --unbounded) until\n"
+            "                      each settles, and print one result line per soup\n"
+            "  --chance P          percent of soup cells alive (default %d)\n"
+            "  --seed S            seed for random fills, so a run can be repeated;\n"
+            "                      soup or fill i is seeded with S + i (default:\n"
+            "                      the time)\n"
+            "  --format F          csv (default) or json lines\n"
+            "  --max-generations G give up on a soup settling after G generations\n"
+            "                      (default %llu)\n",
+            prog, INIT_HASHLIFE_NODES, INIT_FPS, INIT_HISTORY_MB, SOUP_SIZE, SOUP_SIZE, INIT_CHANCE,
+            (unsigned long long) INIT_MAX_GENERATIONS);
+}
+
+// parses a whole decimal number in [min, max]
+bool parse_long(char const *arg, long min, long max, long *value)
+{
+    char *end;
+    long n = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || n < min || n > max) {
+        return false;
+    }
+    *value = n;
+    return true;
+}
+
+bool parse_threads(char const *arg, int *nthreads)
+{
+    long n;
+    if (!parse_long(arg, 0, 1024, &n)) {
+        return false;
+    }
+
+    if (n == 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    *nthreads = n < 1 ? 1 : (int) n;
+    return true;
+}
+
+// parses ROWSxCOLS
+bool parse_size(char const *arg, int *nrows, int *ncols)
+{
+    char *end;
+    long rows = strtol(arg, &end, 10);
+    if (end == arg || *end != 'x') {
+        return false;
+    }
+
+    long cols;
+    if (!parse_long(end + 1, 1, INT_MAX - 128, &cols) || rows < 1 || rows > INT_MAX - 128) {
+        return false;
+    }
+    *nrows = (int) rows;
+    *ncols = (int) cols;
+    return true;
 }
 
-int main()
+bool parse_engine(char const *name, Engine *engine)
 {
-    time_t t;
-    srand(time(&t));
-        
+    for (size_t i = 0; i < sizeof ENGINE_NAMES / sizeof *ENGINE_NAMES; i++) {
+        if (strcmp(name, ENGINE_NAMES[i]) == 0) {
+            *engine = (Engine) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_boundary(char const *name, Boundary *boundary)
+{
+    for (size_t i = 0; i < sizeof BOUNDARY_NAMES / sizeof *BOUNDARY_NAMES; i++) {
+        if (strcmp(name, BOUNDARY_NAMES[i]) == 0) {
+            *boundary = (Boundary) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_render(char const *name, Render *render)
+{
+    for (size_t i = 0; i < sizeof RENDER_NAMES / sizeof *RENDER_NAMES; i++) {
+        if (strcmp(name, RENDER_NAMES[i]) == 0) {
+            *render = (Render) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_on_cycle(char const *name, OnCycle *on_cycle)
+{
+    for (size_t i = 0; i < sizeof ON_CYCLE_NAMES / sizeof *ON_CYCLE_NAMES; i++) {
+        if (strcmp(name, ON_CYCLE_NAMES[i]) == 0) {
+            *on_cycle = (OnCycle) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_options(int argc, char *argv[], Options *opts)
+{
+    static const struct option long_options[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"threads", required_argument, NULL, 't'},
+        {"size", required_argument, NULL, 's'},
+        {"unbounded", no_argument, NULL, 'u'},
+        {"step-exp", required_argument, NULL, 'k'},
+        {"hashlife-nodes", required_argument, NULL, 'N'},
+        {"load", required_argument, NULL, 'l'},
+        {"save", required_argument, NULL, 'o'},
+        {"fps", required_argument, NULL, 'f'},
+        {"soups", required_argument, NULL, 'n'},
+        {"chance", required_argument, NULL, 'c'},
+        {"seed", required_argument, NULL, 'S'},
+        {"format", required_argument, NULL, 'F'},
+        {"max-generations", required_argument, NULL, 'g'},
+        {"on-cycle", required_argument, NULL, 'C'},
+        {"generations", required_argument, NULL, 'G'},
+        {"rule", required_argument, NULL, 'r'},
+        {"boundary", required_argument, NULL, 'b'},
+        {"timings", required_argument, NULL, 'T'},
+        {"history-size", required_argument, NULL, 'H'},
+        {"history-file", required_argument, NULL, 'Y'},
+        {"render", required_argument, NULL, 'R'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    *opts = (Options){
+        .engine = ENGINE_PACKED,
+        .rule = LIFE_RULE,
+        .boundary = BOUNDARY_DEAD,
+        .nrows = 0,
+        .ncols = 0,
+        .unbounded = false,
+        .nthreads = 1,
+        .step_exp = 0,
+        .hashlife_nodes = INIT_HASHLIFE_NODES,
+        .load = NULL,
+        .save = NULL,
+        .timings = NULL,
+        .fps = INIT_FPS,
+        .soups = 0,
+        .chance = INIT_CHANCE,
+        .seed = (unsigned) time(NULL),
+        .format = OUTPUT_CSV,
+        .max_generations = INIT_MAX_GENERATIONS,
+        .on_cycle = ON_CYCLE_REPORT,
+        .target = 0,
+        .history_size = (size_t) INIT_HISTORY_MB << 20,
+        .history_file = NULL,
+        .render = RENDER_GRID,
+    };
+
+    char const *env_threads = getenv("LIFE_THREADS");
+    if (env_threads && !parse_threads(env_threads, &opts->nthreads)) {
+        fprintf(stderr, "%s: invalid LIFE_THREADS '%s'\n", argv[0], env_threads);
+        return false;
+    }
+
+    int opt;
+    long value;
+    while ((opt = getopt_long(argc, argv, "e:t:s:uk:N:l:o:f:n:c:S:F:g:C:G:r:b:T:H:Y:R:h", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'e':
+                if (!parse_engine(optarg, &opts->engine)) {
+                    fprintf(stderr, "%s: unknown engine '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 't':
+                if (!parse_threads(optarg, &opts->nthreads)) {
+                    fprintf(stderr, "%s: invalid thread count '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 's':
+                if (!parse_size(optarg, &opts->nrows, &opts->ncols)) {
+                    fprintf(stderr, "%s: invalid size '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 'u':
+                opts->unbounded = true;
+                break;
+            case 'k':
+                if (!parse_long(optarg, 0, HASHLIFE_MAX_STEP_EXP, &value)) {
+                    fprintf(stderr, "%s: step exponent must be 0 to %d\n",
+                            argv[0], HASHLIFE_MAX_STEP_EXP);
+                    return false;
+                }
+                opts->step_exp = (int) value;
+                break;
+            case 'N':
+                if (!parse_long(optarg, 1024, LONG_MAX, &value)) {
+                    fprintf(stderr, "%s: invalid node cap '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->hashlife_nodes = (size_t) value;
+                break;
+            case 'l':
+                opts->load = optarg;
+                break;
+            case 'o':
+                opts->save = optarg;
+                break;
+            case 'T':
+                opts->timings = optarg;
+                break;
+            case 'f':
+                if (!parse_long(optarg, 1, 1000, &value)) {
+                    fprintf(stderr, "%s: frame rate must be 1 to 1000\n", argv[0]);
+                    return false;
+                }
+                opts->fps = (int) value;
+                break;
+            case 'n':
+                if (!parse_long(optarg, 1, LONG_MAX, &opts->soups)) {
+                    fprintf(stderr, "%s: invalid soup count '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 'c':
+                if (!parse_long(optarg, 0, 100, &value)) {
+                    fprintf(stderr, "%s: chance must be 0 to 100\n", argv[0]);
+                    return false;
+                }
+                opts->chance = (int) value;
+                break;
+            case 'S':
+                if (!parse_long(optarg, 0, UINT_MAX, &value)) {
+                    fprintf(stderr, "%s: invalid seed '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->seed = (unsigned) value;
+                break;
+            case 'F':
+                if (strcmp(optarg, "csv") == 0) {
+                    opts->format = OUTPUT_CSV;
+                }
+                else if (strcmp(optarg, "json") == 0) {
+                    opts->format = OUTPUT_JSON;
+                }
+                else {
+                    fprintf(stderr, "%s: unknown format '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 'g':
+                if (!parse_long(optarg, 1, LONG_MAX, &value)) {
+                    fprintf(stderr, "%s: invalid generation limit '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->max_generations = (uint64_t) value;
+                break;
+            case 'C':
+                if (!parse_on_cycle(optarg, &opts->on_cycle)) {
+                    fprintf(stderr, "%s: unknown cycle action '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 'G':
+                if (!parse_long(optarg, 1, LONG_MAX, &value)) {
+                    fprintf(stderr, "%s: invalid generation '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->target = (uint64_t) value;
+                break;
+            case 'r':
+                if (!parse_rule(optarg, &opts->rule)) {
+                    fprintf(stderr, "%s: invalid rule '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                if (opts->rule.birth & 1) {
+                    fprintf(stderr, "%s: B0 rules are not supported\n", argv[0]);
+                    return false;
+                }
+                break;
+            case 'b':
+                if (!parse_boundary(optarg, &opts->boundary)) {
+                    fprintf(stderr, "%s: unknown boundary '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 'H':
+                if (!parse_long(optarg, 0, 1 << 20, &value)) {
+                    fprintf(stderr, "%s: invalid history size '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                opts->history_size = (size_t) value << 20;
+                break;
+            case 'Y':
+                opts->history_file = optarg;
+                break;
+            case 'R':
+                if (!parse_render(optarg, &opts->render)) {
+                    fprintf(stderr, "%s: unknown render mode '%s'\n", argv[0], optarg);
+                    return false;
+                }
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                return false;
+        }
+    }
+
+    if (opts->unbounded && opts->engine == ENGINE_SCALAR) {
+        fprintf(stderr, "%s: the scalar engine needs a bounded grid\n", argv[0]);
+        return false;
+    }
+    if (opts->unbounded && opts->nrows > 0) {
+        fprintf(stderr, "%s: --size and --unbounded conflict\n", argv[0]);
+        return false;
+    }
+    // a soup settles once it repeats, which an unbounded one that sends off
+    // a glider never does
+    if (opts->unbounded && opts->soups > 0) {
+        fprintf(stderr, "%s: --soups needs a bounded grid\n", argv[0]);
+        return false;
+    }
+
+    // an unbounded universe has no edges, and hashlife's grid is only a
+    // window onto one
+    if (opts->boundary != BOUNDARY_DEAD
+        && (opts->unbounded || opts->engine == ENGINE_HASHLIFE))
+    {
+        fprintf(stderr, "%s: --boundary %s needs a bounded grid and a packed, active or"
+                " scalar engine\n", argv[0], BOUNDARY_NAMES[opts->boundary]);
+        return false;
+    }
+    if (opts->history_file
+        && (opts->history_size == 0 || opts->unbounded || opts->engine == ENGINE_HASHLIFE))
+    {
+        fprintf(stderr, "%s: --history-file needs a history size, a bounded grid and a"
+                " packed, active or scalar engine\n", argv[0]);
+        return false;
+    }
+    if (opts->on_cycle == ON_CYCLE_FFWD && opts->target == 0) {
+        fprintf(stderr, "%s: --on-cycle ffwd needs --generations\n", argv[0]);
+        return false;
+    }
+
+    opts->soup_rows = opts->nrows > 0 ? opts->nrows : SOUP_SIZE;
+    opts->soup_cols = opts->nrows > 0 ? opts->ncols : SOUP_SIZE;
+
+    return optind == argc;
+}
+
+int main(int argc, char *argv[])
+{
+    Options opts;
+    if (!parse_options(argc, argv, &opts)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (opts.soups > 0) {
+        return run_ensemble(argv[0], &opts);
+    }
+
+    FILE *timings = NULL;
+    if (opts.timings)
+    {
+        timings = fopen(opts.timings, "w");
+        if (!timings) {
+            fprintf(stderr, "%s: cannot open %s: %s\n", argv[0], opts.timings, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        fputs("phase,generation,ms\n", timings);
+    }
+
+    // a grid sized to the terminal fits in well under the smallest history,
+    // a megabyte
+    if (opts.nrows > 0 && !opts.unbounded && opts.engine != ENGINE_HASHLIFE
+        && opts.history_size > 0
+        && opts.history_size < timeline_keyframe_max(opts.nrows, opts.ncols))
+    {
+        fprintf(stderr, "%s: warning: a %dx%d grid may not fit %zu MB of history;"
+                " stepping back and rewinding will do nothing then, while the"
+                " checkpoints still tried every %d generations cost step time\n",
+                argv[0], opts.nrows, opts.ncols, opts.history_size >> 20,
+                CHECKPOINT_INTERVAL);
+    }
+
+    unsigned nfills = 0;
+
+    // the half block and Braille characters are written as UTF-8
+    setlocale(LC_ALL, "");
     initscr();
     cbreak();
     keypad(stdscr, TRUE);
@@ -443,25 +1775,85 @@ int main()
     View *view = &v;
     // offset depends on terminal margins
     view_init(view, LINES - 3, COLS - 3, 2, 2);
+    view->render = opts.render;
 
-    Model *model = model_new(view);
+    // without --size, the grid fills the view
+    Model *model = model_new(&(ModelConfig){
+        .nrows = opts.nrows > 0 ? opts.nrows : view_rows(view),
+        .ncols = opts.nrows > 0 ? opts.ncols : view_cols(view),
+        .unbounded = opts.unbounded,
+        .engine = opts.engine,
+        .rule = opts.rule,
+        .boundary = opts.boundary,
+        .nthreads = opts.nthreads,
+        .hashlife_nodes = opts.hashlife_nodes,
+        .step_exp = opts.step_exp,
+    });
+    Timeline *timeline = NULL;
+    // hashlife's grid is only a window, so checkpoints of it can't restore it
+    if (!opts.unbounded && opts.engine != ENGINE_HASHLIFE && opts.history_size > 0)
+    {
+        timeline = timeline_new(model, opts.history_size, opts.history_file);
+        if (!timeline) {
+            int err = errno;
+            model_destroy(model);
+            endwin();
+            if (timings) {
+                fclose(timings);
+            }
+            fprintf(stderr, "%s: cannot keep history in %s: %s\n", argv[0],
+                    opts.history_file ? opts.history_file : "memory", strerror(err));
+            return EXIT_FAILURE;
+        }
+    }
+    char const *load = opts.load;
     while (true)
     {
         State state;
         clear_view(view);
         clear_model(view, model);
-        state = user_fill_grid(view, model);
+        if (load)
+        {
+            if (!pattern_load(model, load, 0, 0)) {
+                int err = errno;
+                model_destroy(model);
+                if (timeline) {
+                    timeline_destroy(timeline);
+                }
+                endwin();
+                if (timings) {
+                    fclose(timings);
+                }
+                fprintf(stderr, "%s: cannot load %s: %s\n", argv[0], load, strerror(err));
+                return EXIT_FAILURE;
+            }
+            draw_view(view, model);
+            load = NULL;
+        }
+        state = user_fill_grid(view, model, opts.seed, &nfills);
         if (state == EXIT) {
             break;
         }
-        state = simulate(view, model);
+        state = simulate(view, model, &opts, timings, timeline);
         if (state == EXIT) {
             break;
         }
     }
 
+    bool saved = !opts.save || pattern_save(model, opts.save);
+    int err = errno;
     model_destroy(model);
+    if (timeline) {
+        timeline_destroy(timeline);
+    }
     endwin();
+    if (timings) {
+        fclose(timings);
+    }
 
+    if (!saved) {
+        fprintf(stderr, "%s: cannot save %s: %s\n", argv[0], opts.save, strerror(err));
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "model.h"
+
+// run as `life_test NAME` by CTest, one pattern per test. every engine steps
+// the pattern from its start, and the generations checked must match states
+// computed by an independent implementation. the engines_BOUNDARY tests
+// instead step random soups under many rules, checking every engine against
+// a naive grid
+
+static const size_t TEST_HASHLIFE_NODES = 1 << 20;
+
+// a pattern as RLE, placed with its top left corner at (top, left)
+typedef struct Placed{
+    char const *rle;
+    int top;
+    int left;
+} Placed;
+
+typedef struct Check{
+    uint64_t generation;
+    Placed expected;
+} Check;
+
+typedef struct Case{
+    char const *name;
+    // side of the bounded grids the pattern runs in, big enough that the
+    // edges never come into play
+    int size;
+    Placed start;
+    // in order of generation, ending at the first without a pattern
+    Check checks[3];
+} Case;
+
+static const char GLIDER[] = "bo$2bo$3o!";
+
+static const char GOSPER_GUN[] =
+    "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$"
+    "2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o!";
+
+// the gun after one period, with its first glider on the way
+static const char GOSPER_GUN_30[] =
+    "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$"
+    "2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o$23bo$24b2o$23b2o!";
+
+// the R-pentomino's 116 cells at generation 1103, when it has settled into
+// still lifes, oscillators and six escaping gliders, 258 rows above and 240
+// columns left of where it started
+static const char R_PENTOMINO_1103[] =
+    "479b2o$478bobo$480bo28$bo$2o$obo117$180b2o$180bobo$180bo90$265b2o$26"
+    "4bo2bo$265bobo$266bo$235bo$234bobo3b2o$235b2o3b2o3$284b3o$271b3o2$29"
+    "3b2o$293b2o5$201b2o$200bobo$200b2o31bo$232bobo$232bobo$233bo6bo$219b"
+    "2o18bobo$219b2o18bobo$240bo2$211b2o$211b2o56b2o$269b2o2$241b3o51b2o$"
+    "295b2o4$307bo$306bobo$283b2o21bobo$283b2o22bo3$295b3o$265bo$264bobo$"
+    "264bobo$265bo2$249b2o$249b2o208$473bo$474b2o$473b2o7$499bo$500bo$498"
+    "b3o12$454bo$455b2o$454b2o!";
+
+static const Case CASES[] = {
+    {"blinker", 32, {"3o!", 10, 10}, {
+        {1, {"o$o$o!", 9, 11}},
+        {2, {"3o!", 10, 10}},
+    }},
+    // a glider moves a cell down and right every 4 generations
+    {"glider", 64, {GLIDER, 10, 10}, {
+        {4, {GLIDER, 11, 11}},
+        {40, {GLIDER, 20, 20}},
+    }},
+    {"gosper_gun", 64, {GOSPER_GUN, 5, 5}, {
+        {30, {GOSPER_GUN_30, 5, 5}},
+    }},
+    {"r_pentomino", 544, {"b2o$2o$bo!", 268, 250}, {
+        {1103, {R_PENTOMINO_1103, 268 - 258, 250 - 240}},
+    }},
+};
+
+// the ways a model can be stepped
+typedef struct Config{
+    char const *name;
+    Engine engine;
+    bool unbounded;
+    int nthreads;
+} Config;
+
+static const Config CONFIGS[] = {
+    {"scalar", ENGINE_SCALAR, false, 1},
+    {"packed", ENGINE_PACKED, false, 1},
+    {"packed, 2 threads", ENGINE_PACKED, false, 2},
+    {"active", ENGINE_ACTIVE, false, 1},
+    {"hashlife", ENGINE_HASHLIFE, false, 1},
+    {"packed, unbounded", ENGINE_PACKED, true, 1},
+    {"hashlife, unbounded", ENGINE_HASHLIFE, true, 1},
+};
+
+// the plain grid expected states are laid out in
+static const Config REFERENCE = {"reference", ENGINE_PACKED, false, 1};
+
+// every rule with a specialized kernel, then two taking the generic path
+static const Rule RULES[] = {
+    {0x008, 0x00c},
+    {0x048, 0x00c},
+    {0x1c8, 0x1d8},
+    {0x004, 0x000},
+    {0x0aa, 0x0aa},
+    {0x148, 0x034},
+    {0x008, 0x1ff},
+    {0x018, 0x018},
+    {0x1e8, 0x1e0},
+    {0x048, 0x026},
+    {0x024, 0x010},
+    {0x038, 0x020},
+};
+
+// grid shapes for the soups, with columns that don't fill the last word
+// and rows that don't fill the last tile of the active engine
+static const int SHAPES[][2] = {{45, 131}, {70, 200}};
+
+// the engines soups are stepped with. hashlife's bounded grid is a window
+// onto an unbounded universe, so it is only checked unbounded, and only dead
+// edges have an unbounded counterpart
+static const Config SOUP_CONFIGS[] = {
+    {"scalar", ENGINE_SCALAR, false, 1},
+    {"packed", ENGINE_PACKED, false, 1},
+    {"packed, 3 threads", ENGINE_PACKED, false, 3},
+    {"active", ENGINE_ACTIVE, false, 1},
+    {"active, 3 threads", ENGINE_ACTIVE, false, 3},
+    {"packed, unbounded", ENGINE_PACKED, true, 1},
+    {"hashlife, unbounded", ENGINE_HASHLIFE, true, 1},
+};
+
+#define SOUP_GENERATIONS 60
+#define SOUP_CHECK_INTERVAL 10
+#define SOUP_CHANCE 35
+#define SOUP_SEED 42
+
+// an nrows x ncols grid (unless unbounded) stepped as config says.
+// hashlife steps one generation at a time, so every generation can be
+// checked
+Model *rule_model(Config const *config, int nrows, int ncols, Rule const *rule,
+        Boundary boundary)
+{
+    return model_new(&(ModelConfig){
+        .nrows = nrows,
+        .ncols = ncols,
+        .unbounded = config->unbounded,
+        .engine = config->engine,
+        .rule = *rule,
+        .boundary = boundary,
+        .nthreads = config->nthreads,
+        .hashlife_nodes = TEST_HASHLIFE_NODES,
+        .step_exp = 0,
+    });
+}
+
+Model *config_model(Config const *config, int size)
+{
+    return rule_model(config, size, size, &LIFE_RULE, BOUNDARY_DEAD);
+}
+
+bool place(Model *model, Placed const *placed)
+{
+    PatternReader reader = {
+        .format = FORMAT_RLE,
+        .model = model,
+        .top = placed->top,
+        .left = placed->left,
+        .state = READ_LINE_START,
+    };
+    reader_feed(&reader, placed->rle, strlen(placed->rle));
+    model_invalidate(model);
+    return !reader.error;
+}
+
+// steps the case on one configuration, reporting each check that fails
+int run_case(Case const *test, Config const *config)
+{
+    int failures = 0;
+    Model *model = config_model(config, test->size);
+    if (!place(model, &test->start)) {
+        fprintf(stderr, "%s: bad start pattern\n", test->name);
+        model_destroy(model);
+        return 1;
+    }
+
+    for (int i = 0; i < 3 && test->checks[i].expected.rle; i++)
+    {
+        Check const *check = &test->checks[i];
+        while (model->generation < check->generation) {
+            model_step(model);
+        }
+
+        // the expected state is laid out in a plain grid at the same
+        // coordinates, and the hash of the cells compared
+        Model *expected = config_model(&REFERENCE, test->size);
+        if (!place(expected, &check->expected)) {
+            fprintf(stderr, "%s: bad pattern for generation %llu\n", test->name,
+                    (unsigned long long) check->generation);
+            failures++;
+        }
+        else if (model->generation != check->generation
+            || model_population(model) != model_population(expected)
+            || model_hash(model) != model_hash(expected))
+        {
+            fprintf(stderr, "%s (%s): generation %llu differs from the reference (population %llu, expected %llu)\n",
+                    test->name, config->name, (unsigned long long) check->generation,
+                    (unsigned long long) model_population(model),
+                    (unsigned long long) model_population(expected));
+            failures++;
+        }
+        model_destroy(expected);
+    }
+
+    model_destroy(model);
+    return failures;
+}
+
+// a plain array of cells stepped one at a time, with the boundary applied
+// by mapping coordinates rather than through a ghost border as the engines
+// do
+typedef struct Naive{
+    int nrows;
+    int ncols;
+    Rule rule;
+    Boundary boundary;
+    bool *cells;
+    bool *next;
+} Naive;
+
+bool naive_get(Naive const *naive, int y, int x)
+{
+    if (y < 0 || y >= naive->nrows || x < 0 || x >= naive->ncols)
+    {
+        if (naive->boundary == BOUNDARY_DEAD) {
+            return false;
+        }
+        if (naive->boundary == BOUNDARY_TORUS) {
+            y = (y + naive->nrows) % naive->nrows;
+            x = (x + naive->ncols) % naive->ncols;
+        }
+        else {
+            y = y < 0 ? 0 : y >= naive->nrows ? naive->nrows - 1 : y;
+            x = x < 0 ? 0 : x >= naive->ncols ? naive->ncols - 1 : x;
+        }
+    }
+    return naive->cells[y * naive->ncols + x];
+}
+
+void naive_step(Naive *naive)
+{
+    for (int y = 0; y < naive->nrows; y++)
+    {
+        for (int x = 0; x < naive->ncols; x++)
+        {
+            int n = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    n += (dy != 0 || dx != 0) && naive_get(naive, y + dy, x + dx);
+                }
+            }
+            unsigned mask = naive_get(naive, y, x) ? naive->rule.survive : naive->rule.birth;
+            naive->next[y * naive->ncols + x] = (mask >> n) & 1;
+        }
+    }
+
+    bool *temp = naive->cells;
+    naive->cells = naive->next;
+    naive->next = temp;
+}
+
+// whether the model's cells match the naive ones, which sit pad cells in
+// from the model's origin, and nothing lives outside them
+bool naive_matches(Naive const *naive, Model *model, int pad)
+{
+    uint64_t population = 0;
+    for (int y = 0; y < naive->nrows; y++)
+    {
+        for (int x = 0; x < naive->ncols; x++)
+        {
+            bool alive = naive->cells[y * naive->ncols + x];
+            if (model_get(model, y - pad, x - pad) != alive) {
+                return false;
+            }
+            population += alive;
+        }
+    }
+    return model_population(model) == population;
+}
+
+// steps a soup with each of configs and a naive grid side by side, failing
+// where they differ or where a model's running hash has drifted from its
+// cells. unbounded models are matched against a naive grid with dead edges
+// padded far enough that the soup can't reach them
+int run_soup(Config const *const *configs, int nconfigs, bool unbounded,
+        Rule const *rule, Boundary boundary, int nrows, int ncols)
+{
+    int pad = unbounded ? SOUP_GENERATIONS + 1 : 0;
+    Naive naive = {
+        .nrows = nrows + 2 * pad,
+        .ncols = ncols + 2 * pad,
+        .rule = *rule,
+        .boundary = boundary,
+    };
+    naive.cells = calloc((size_t) naive.nrows * naive.ncols, sizeof(bool));
+    naive.next = calloc((size_t) naive.nrows * naive.ncols, sizeof(bool));
+
+    Model *models[sizeof SOUP_CONFIGS / sizeof *SOUP_CONFIGS];
+    for (int i = 0; i < nconfigs; i++)
+    {
+        models[i] = rule_model(configs[i], nrows, ncols, rule, boundary);
+        Rng rng;
+        rng_seed(&rng, SOUP_SEED);
+        model_random_fill(models[i], SOUP_CHANCE, 0, 0, nrows, ncols, &rng);
+        model_invalidate(models[i]);
+    }
+    for (int y = 0; y < nrows; y++) {
+        for (int x = 0; x < ncols; x++) {
+            naive.cells[(y + pad) * naive.ncols + x + pad] = model_get(models[0], y, x);
+        }
+    }
+
+    char name[32];
+    rule_format(rule, name, sizeof name);
+    int failures = 0;
+    for (int gen = 1; gen <= SOUP_GENERATIONS && failures == 0; gen++)
+    {
+        naive_step(&naive);
+        for (int i = 0; i < nconfigs; i++)
+        {
+            Model *model = models[i];
+            model_step(model);
+            if (gen % SOUP_CHECK_INTERVAL != 0) {
+                continue;
+            }
+
+            if (model->hash != model_hash(model)) {
+                fprintf(stderr, "%s, %s, %dx%d (%s): generation %d has a stale hash\n",
+                        name, BOUNDARY_NAMES[boundary], nrows, ncols, configs[i]->name, gen);
+                failures++;
+            }
+            else if (!naive_matches(&naive, model, pad)) {
+                fprintf(stderr, "%s, %s, %dx%d (%s): generation %d differs from the naive grid\n",
+                        name, BOUNDARY_NAMES[boundary], nrows, ncols, configs[i]->name, gen);
+                failures++;
+            }
+        }
+    }
+
+    for (int i = 0; i < nconfigs; i++) {
+        model_destroy(models[i]);
+    }
+    free(naive.cells);
+    free(naive.next);
+    return failures;
+}
+
+// every rule and shape on every engine that supports the boundary, the
+// bounded and unbounded engines each against their own naive grid
+int run_soups(Boundary boundary)
+{
+    int failures = 0;
+    for (int unbounded = 0; unbounded <= (boundary == BOUNDARY_DEAD); unbounded++)
+    {
+        Config const *configs[sizeof SOUP_CONFIGS / sizeof *SOUP_CONFIGS];
+        int nconfigs = 0;
+        for (size_t k = 0; k < sizeof SOUP_CONFIGS / sizeof *SOUP_CONFIGS; k++) {
+            if (SOUP_CONFIGS[k].unbounded == unbounded) {
+                configs[nconfigs++] = &SOUP_CONFIGS[k];
+            }
+        }
+
+        for (size_t i = 0; i < sizeof RULES / sizeof *RULES; i++) {
+            for (size_t j = 0; j < sizeof SHAPES / sizeof *SHAPES; j++) {
+                failures += run_soup(configs, nconfigs, unbounded, &RULES[i], boundary,
+                        SHAPES[j][0], SHAPES[j][1]);
+            }
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s PATTERN\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < sizeof CASES / sizeof *CASES; i++)
+    {
+        if (strcmp(CASES[i].name, argv[1]) != 0) {
+            continue;
+        }
+
+        int failures = 0;
+        for (size_t j = 0; j < sizeof CONFIGS / sizeof *CONFIGS; j++) {
+            failures += run_case(&CASES[i], &CONFIGS[j]);
+        }
+        if (failures == 0) {
+            printf("%s: all engines match\n", CASES[i].name);
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (int b = 0; b < (int) (sizeof BOUNDARY_NAMES / sizeof *BOUNDARY_NAMES); b++)
+    {
+        char name[32];
+        snprintf(name, sizeof name, "engines_%s", BOUNDARY_NAMES[b]);
+        if (strcmp(name, argv[1]) != 0) {
+            continue;
+        }
+
+        int failures = run_soups((Boundary) b);
+        if (failures == 0) {
+            printf("%s: all engines agree\n", name);
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%s: no pattern named %s\n", argv[0], argv[1]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,3186 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "model.h"
+
+// steps rows [row_begin, row_end) of the model into its back buffer, with
+// changed as scratch for the words each row flips (model->nwords of them)
+typedef void BandFn(Model *model, int row_begin, int row_end, uint64_t *changed);
+
+// persistent workers that each step one horizontal band of rows per
+// generation, with the calling thread taking the first band
+struct Pool{
+    int nthreads;
+    pthread_t *threads;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    // work for the current generation, set before start is released
+    BandFn *band;
+    Model *model;
+    int align;
+    bool quit;
+    // a scratch row of changed words per band, each stride words apart
+    uint64_t *changed;
+    int stride;
+};
+
+typedef struct Worker{
+    Pool *pool;
+    int index;
+} Worker;
+
+// rows of band index out of nbands, split as evenly as possible with
+// every band starting on a multiple of align
+static void band_rows(int nrows, int index, int nbands, int align,
+        int *row_begin, int *row_end)
+{
+    long long units = (nrows + align - 1) / align;
+    long long begin = units * index / nbands * align;
+    long long end = units * (index + 1) / nbands * align;
+
+    *row_begin = begin < nrows ? (int) begin : nrows;
+    *row_end = end < nrows ? (int) end : nrows;
+}
+
+static void pool_band(Pool *pool, int index)
+{
+    int row_begin, row_end;
+    band_rows(pool->model->nrows, index, pool->nthreads, pool->align,
+            &row_begin, &row_end);
+    pool->band(pool->model, row_begin, row_end,
+            pool->changed + (size_t) index * pool->stride);
+}
+
+static void *pool_worker(void *arg)
+{
+    Worker *worker = arg;
+    Pool *pool = worker->pool;
+
+    while (true)
+    {
+        pthread_barrier_wait(&pool->start);
+        if (pool->quit) {
+            break;
+        }
+        pool_band(pool, worker->index);
+        pthread_barrier_wait(&pool->done);
+    }
+
+    free(worker);
+    return NULL;
+}
+
+static Pool *pool_new(int nthreads)
+{
+    Pool *pool = malloc(sizeof *pool);
+    pool->nthreads = nthreads;
+    pool->threads = malloc((nthreads - 1) * sizeof *(pool->threads));
+    pool->band = NULL;
+    pool->model = NULL;
+    pool->align = 1;
+    pool->quit = false;
+    pool->changed = NULL;
+    pool->stride = 0;
+    pthread_barrier_init(&pool->start, NULL, nthreads);
+    pthread_barrier_init(&pool->done, NULL, nthreads);
+
+    // the calling thread is worker 0
+    for (int i = 1; i < nthreads; i++) {
+        Worker *worker = malloc(sizeof *worker);
+        *worker = (Worker){.pool = pool, .index = i};
+        pthread_create(&pool->threads[i - 1], NULL, pool_worker, worker);
+    }
+
+    return pool;
+}
+
+// runs band over all rows of model and waits for every band to finish.
+// band boundaries fall on multiples of align rows
+static void pool_run(Pool *pool, BandFn *band, Model *model, int align)
+{
+    // scratch rows are a whole number of cache lines, so bands don't share one
+    if (pool->stride < model->nwords) {
+        free(pool->changed);
+        pool->stride = (model->nwords + 7) / 8 * 8;
+        pool->changed = malloc((size_t) pool->nthreads * pool->stride * sizeof(uint64_t));
+    }
+    pool->band = band;
+    pool->model = model;
+    pool->align = align;
+    pthread_barrier_wait(&pool->start);
+    pool_band(pool, 0);
+    pthread_barrier_wait(&pool->done);
+}
+
+static void pool_destroy(Pool *pool)
+{
+    pool->quit = true;
+    pthread_barrier_wait(&pool->start);
+    for (int i = 1; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i - 1], NULL);
+    }
+
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->changed);
+    free(pool);
+}
+
+// the generation hash is the sum, modulo 2^64, of HASH_ROW^y * HASH_WORD^w *
+// word_mix(word) over the live words of the grid, word w of row y holding
+// columns 64w to 64w + 63. a sum doesn't depend on the order words are
+// visited in and a step changes it by what the flipped words add and take
+// away. a region moved by dy rows and dw words has its hash multiplied by
+// HASH_ROW^dy * HASH_WORD^dw, so hashlife nodes hash from their quadrants
+#define HASH_ROW UINT64_C(0x9E3779B97F4A7C15)
+#define HASH_WORD UINT64_C(0xBF58476D1CE4E5B9)
+
+// HASH_ROW and HASH_WORD to the power 2^k
+static uint64_t row_powers[64];
+static uint64_t word_powers[64];
+static pthread_once_t hash_once = PTHREAD_ONCE_INIT;
+
+static void hash_init(void)
+{
+    row_powers[0] = HASH_ROW;
+    word_powers[0] = HASH_WORD;
+    for (int k = 1; k < 64; k++) {
+        row_powers[k] = row_powers[k - 1] * row_powers[k - 1];
+        word_powers[k] = word_powers[k - 1] * word_powers[k - 1];
+    }
+}
+
+// HASH_ROW^y * HASH_WORD^w. odd numbers to the power 2^62 are 1 modulo
+// 2^64, so negative exponents are taken modulo 2^62 like positive ones
+static uint64_t word_power(int64_t y, int64_t w)
+{
+    uint64_t power = 1;
+    uint64_t ey = (uint64_t) y & ((UINT64_C(1) << 62) - 1);
+    uint64_t ew = (uint64_t) w & ((UINT64_C(1) << 62) - 1);
+
+    for (int k = 0; ey; k++, ey >>= 1) {
+        if (ey & 1) {
+            power *= row_powers[k];
+        }
+    }
+    for (int k = 0; ew; k++, ew >>= 1) {
+        if (ew & 1) {
+            power *= word_powers[k];
+        }
+    }
+    return power;
+}
+
+// scrambles the cells of a word, keeping dead words at 0 so they don't count
+static uint64_t word_mix(uint64_t word)
+{
+    uint64_t h = word;
+    h = (h ^ (h >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return h ^ (h >> 31);
+}
+
+// change to the generation hash from the words of a stepped row that
+// changed, with power the word_power of the row's first word. the old words
+// are recovered from out and changed rather than read from the grid, which
+// may hold ghost cells. with changed the same as out it is the row's hash
+static uint64_t row_hash_delta(uint64_t power, uint64_t const *out, uint64_t const *changed,
+        int nwords)
+{
+    uint64_t delta = 0;
+    for (int i = 0; i < nwords; i++)
+    {
+        if (changed[i]) {
+            delta += power * (word_mix(out[i]) - word_mix(out[i] ^ changed[i]));
+        }
+        power *= HASH_WORD;
+    }
+    return delta;
+}
+
+// hashlife: the universe as a quadtree of canonical nodes, so repeated
+// regions are stored and stepped once. a node of level n is 2^n cells
+// square; level 0 nodes are single cells
+struct Node{
+    Node *nw;
+    Node *ne;
+    Node *sw;
+    Node *se;
+    // centre half of the node advanced by 2^min(step_exp, level - 2)
+    // generations, once computed
+    Node *result;
+    // hash chain, or free list link for unused nodes
+    Node *next;
+    uint64_t population;
+    // generation hash of the node's cells with its top left at (0, 0), for
+    // nodes of level 6 or more once hashed is set
+    uint64_t hash;
+    // -1 for nodes on the free list
+    int level;
+    bool marked;
+    bool hashed;
+};
+
+typedef struct NodeChunk{
+    struct NodeChunk *next;
+    Node nodes[HASHLIFE_CHUNK];
+} NodeChunk;
+
+struct HashLife{
+    Node **table;
+    size_t table_size;
+    size_t nnodes;
+    // cache cap; past it unreachable nodes are collected between steps
+    size_t max_nodes;
+    // node count the next collection waits for. the cap only limits garbage:
+    // the threshold stays at least twice what the last collection kept plus
+    // what a step builds, so a tree or a step bigger than the cap doesn't get
+    // collected, and its results dropped, on every step
+    size_t collect_at;
+    // nodes the last step built
+    size_t step_nodes;
+    Node *free_nodes;
+    NodeChunk *chunks;
+    Node cells[2];
+    Node *empty[HASHLIFE_MAX_LEVEL + 1];
+    Node *root;
+    // model coordinates of the root's top left cell
+    int64_t origin_y;
+    int64_t origin_x;
+    // each step advances 2^step_exp generations
+    int step_exp;
+    Rule rule;
+};
+
+// whether a cell with n live neighbours is alive next generation
+static bool rule_next(Rule const *rule, bool alive, int n)
+{
+    return ((alive ? rule->survive : rule->birth) >> n) & 1;
+}
+
+static size_t node_hash(Node const *nw, Node const *ne, Node const *sw, Node const *se)
+{
+    uint64_t h = (uintptr_t) nw;
+    h = h * UINT64_C(0x9E3779B97F4A7C15) + (uintptr_t) ne;
+    h = h * UINT64_C(0x9E3779B97F4A7C15) + (uintptr_t) sw;
+    h = h * UINT64_C(0x9E3779B97F4A7C15) + (uintptr_t) se;
+    return (size_t) (h ^ (h >> 32));
+}
+
+static void hashlife_rehash(HashLife *hl, size_t table_size)
+{
+    Node **table = calloc(table_size, sizeof *table);
+
+    for (size_t i = 0; i < hl->table_size; i++)
+    {
+        Node *node = hl->table[i];
+        while (node)
+        {
+            Node *next = node->next;
+            size_t h = node_hash(node->nw, node->ne, node->sw, node->se) & (table_size - 1);
+            node->next = table[h];
+            table[h] = node;
+            node = next;
+        }
+    }
+
+    free(hl->table);
+    hl->table = table;
+    hl->table_size = table_size;
+}
+
+static Node *hashlife_alloc(HashLife *hl)
+{
+    if (!hl->free_nodes)
+    {
+        NodeChunk *chunk = malloc(sizeof *chunk);
+        chunk->next = hl->chunks;
+        hl->chunks = chunk;
+        for (int i = HASHLIFE_CHUNK - 1; i >= 0; i--) {
+            chunk->nodes[i].level = -1;
+            chunk->nodes[i].next = hl->free_nodes;
+            hl->free_nodes = &chunk->nodes[i];
+        }
+    }
+
+    Node *node = hl->free_nodes;
+    hl->free_nodes = node->next;
+    return node;
+}
+
+// the canonical node with the given quadrants
+static Node *hashlife_node(HashLife *hl, Node *nw, Node *ne, Node *sw, Node *se)
+{
+    size_t h = node_hash(nw, ne, sw, se) & (hl->table_size - 1);
+
+    for (Node *node = hl->table[h]; node; node = node->next)
+    {
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) {
+            return node;
+        }
+    }
+
+    Node *node = hashlife_alloc(hl);
+    *node = (Node){
+        .nw = nw, .ne = ne, .sw = sw, .se = se,
+        .result = NULL,
+        .next = hl->table[h],
+        .population = nw->population + ne->population
+            + sw->population + se->population,
+        .level = nw->level + 1,
+        .marked = false,
+        .hashed = false,
+    };
+    hl->table[h] = node;
+
+    if (++hl->nnodes > hl->table_size) {
+        hashlife_rehash(hl, hl->table_size * 2);
+    }
+    return node;
+}
+
+static Node *hashlife_empty(HashLife *hl, int level)
+{
+    if (level == 0) {
+        return &hl->cells[0];
+    }
+    if (!hl->empty[level])
+    {
+        Node *e = hashlife_empty(hl, level - 1);
+        hl->empty[level] = hashlife_node(hl, e, e, e, e);
+    }
+    return hl->empty[level];
+}
+
+// centre half of a node of level 2 or more, not advanced
+static Node *hashlife_centre(HashLife *hl, Node *node)
+{
+    return hashlife_node(hl, node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+// centre 2x2 of a 4x4 node after one generation
+static Node *hashlife_base(HashLife *hl, Node *node)
+{
+    Node const *quads[2][2] = {{node->nw, node->ne}, {node->sw, node->se}};
+    int cells[4][4];
+
+    for (int j = 0; j < 4; j++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            Node const *quad = quads[j / 2][i / 2];
+            Node const *cells_of[2][2] = {{quad->nw, quad->ne}, {quad->sw, quad->se}};
+            cells[j][i] = (int) cells_of[j % 2][i % 2]->population;
+        }
+    }
+
+    Node *next[2][2];
+    for (int j = 1; j <= 2; j++)
+    {
+        for (int i = 1; i <= 2; i++)
+        {
+            int n = 0;
+            for (int y = j - 1; y <= j + 1; y++) {
+                for (int x = i - 1; x <= i + 1; x++) {
+                    n += cells[y][x];
+                }
+            }
+            n -= cells[j][i];
+
+            bool alive = rule_next(&hl->rule, cells[j][i], n);
+            next[j - 1][i - 1] = &hl->cells[alive];
+        }
+    }
+
+    return hashlife_node(hl, next[0][0], next[0][1], next[1][0], next[1][1]);
+}
+
+// centre half of a node of level 2 or more, advanced by
+// 2^min(step_exp, level - 2) generations
+static Node *hashlife_result(HashLife *hl, Node *node)
+{
+    if (node->result) {
+        return node->result;
+    }
+
+    if (node->population == 0) {
+        node->result = hashlife_empty(hl, node->level - 1);
+        return node->result;
+    }
+    if (node->level == 2) {
+        node->result = hashlife_base(hl, node);
+        return node->result;
+    }
+
+    // nine overlapping subnodes of half the size
+    Node *n00 = node->nw;
+    Node *n01 = hashlife_node(hl, node->nw->ne, node->ne->nw, node->nw->se, node->ne->sw);
+    Node *n02 = node->ne;
+    Node *n10 = hashlife_node(hl, node->nw->sw, node->nw->se, node->sw->nw, node->sw->ne);
+    Node *n11 = hashlife_centre(hl, node);
+    Node *n12 = hashlife_node(hl, node->ne->sw, node->ne->se, node->se->nw, node->se->ne);
+    Node *n20 = node->sw;
+    Node *n21 = hashlife_node(hl, node->sw->ne, node->se->nw, node->sw->se, node->se->sw);
+    Node *n22 = node->se;
+
+    // the first half of the advance happens here when the step is as
+    // large as this level allows; smaller steps all happen below
+    Node *(*stage)(HashLife *, Node *) =
+        hl->step_exp >= node->level - 2 ? hashlife_result : hashlife_centre;
+    Node *r00 = stage(hl, n00);
+    Node *r01 = stage(hl, n01);
+    Node *r02 = stage(hl, n02);
+    Node *r10 = stage(hl, n10);
+    Node *r11 = stage(hl, n11);
+    Node *r12 = stage(hl, n12);
+    Node *r20 = stage(hl, n20);
+    Node *r21 = stage(hl, n21);
+    Node *r22 = stage(hl, n22);
+
+    node->result = hashlife_node(hl,
+        hashlife_result(hl, hashlife_node(hl, r00, r01, r10, r11)),
+        hashlife_result(hl, hashlife_node(hl, r01, r02, r11, r12)),
+        hashlife_result(hl, hashlife_node(hl, r10, r11, r20, r21)),
+        hashlife_result(hl, hashlife_node(hl, r11, r12, r21, r22)));
+    return node->result;
+}
+
+static HashLife *hashlife_new(size_t max_nodes, int step_exp, Rule const *rule)
+{
+    HashLife *hl = malloc(sizeof *hl);
+    *hl = (HashLife){
+        .table_size = 1 << 16,
+        .max_nodes = max_nodes,
+        .collect_at = max_nodes,
+        .step_exp = step_exp,
+        .rule = *rule,
+    };
+    hl->table = calloc(hl->table_size, sizeof *(hl->table));
+    hl->cells[0] = (Node){.population = 0, .level = 0};
+    hl->cells[1] = (Node){.population = 1, .level = 0};
+    hl->root = hashlife_empty(hl, HASHLIFE_MIN_LEVEL);
+
+    return hl;
+}
+
+static void hashlife_destroy(HashLife *hl)
+{
+    while (hl->chunks)
+    {
+        NodeChunk *next = hl->chunks->next;
+        free(hl->chunks);
+        hl->chunks = next;
+    }
+    free(hl->table);
+    free(hl);
+}
+
+static void hashlife_mark(Node *node)
+{
+    if (node->level <= 0 || node->marked) {
+        return;
+    }
+    node->marked = true;
+    hashlife_mark(node->nw);
+    hashlife_mark(node->ne);
+    hashlife_mark(node->sw);
+    hashlife_mark(node->se);
+    if (node->result) {
+        hashlife_mark(node->result);
+    }
+}
+
+// frees every node not reachable from the root, directly or through a
+// cached result, so the results of surviving nodes stay valid
+static void hashlife_collect(HashLife *hl)
+{
+    hashlife_mark(hl->root);
+    for (int level = 1; level <= HASHLIFE_MAX_LEVEL; level++) {
+        if (hl->empty[level]) {
+            hashlife_mark(hl->empty[level]);
+        }
+    }
+
+    memset(hl->table, 0, hl->table_size * sizeof *(hl->table));
+    hl->nnodes = 0;
+
+    for (NodeChunk *chunk = hl->chunks; chunk; chunk = chunk->next)
+    {
+        for (int i = 0; i < HASHLIFE_CHUNK; i++)
+        {
+            Node *node = &chunk->nodes[i];
+            if (node->level < 0) {
+                continue;
+            }
+
+            if (node->marked)
+            {
+                size_t h = node_hash(node->nw, node->ne, node->sw, node->se)
+                    & (hl->table_size - 1);
+                node->marked = false;
+                node->next = hl->table[h];
+                hl->table[h] = node;
+                hl->nnodes++;
+            }
+            else
+            {
+                node->level = -1;
+                node->next = hl->free_nodes;
+                hl->free_nodes = node;
+            }
+        }
+    }
+
+    size_t keep = 2 * (hl->nnodes + hl->step_nodes);
+    hl->collect_at = keep > hl->max_nodes ? keep : hl->max_nodes;
+}
+
+// switches the rule, dropping the results cached under the old one
+static void hashlife_set_rule(HashLife *hl, Rule const *rule)
+{
+    if (hl->rule.birth == rule->birth && hl->rule.survive == rule->survive) {
+        return;
+    }
+
+    hl->rule = *rule;
+    for (NodeChunk *chunk = hl->chunks; chunk; chunk = chunk->next) {
+        for (int i = 0; i < HASHLIFE_CHUNK; i++) {
+            chunk->nodes[i].result = NULL;
+        }
+    }
+}
+
+// doubles the root around its centre
+static void hashlife_expand(HashLife *hl)
+{
+    Node *root = hl->root;
+    Node *e = hashlife_empty(hl, root->level - 1);
+
+    hl->root = hashlife_node(hl,
+        hashlife_node(hl, e, e, e, root->nw),
+        hashlife_node(hl, e, e, root->ne, e),
+        hashlife_node(hl, e, root->sw, e, e),
+        hashlife_node(hl, root->se, e, e, e));
+
+    int64_t half = (int64_t) 1 << (root->level - 1);
+    hl->origin_y -= half;
+    hl->origin_x -= half;
+}
+
+// population of the centre quarter (by side) of a node of level 3 or more
+static uint64_t hashlife_inner_population(Node const *node)
+{
+    return node->nw->se->se->population + node->ne->sw->sw->population
+        + node->sw->ne->ne->population + node->se->nw->nw->population;
+}
+
+// advances the universe 2^step_exp generations and returns that count
+static uint64_t hashlife_advance(HashLife *hl)
+{
+    if (hl->nnodes > hl->collect_at) {
+        hashlife_collect(hl);
+    }
+
+    // the result only covers the root's centre, so pad the pattern until
+    // nothing can travel out of it within the step
+    while (hl->root->level < hl->step_exp + 3 || hl->root->level <= HASHLIFE_MIN_LEVEL
+        || hashlife_inner_population(hl->root) != hl->root->population)
+    {
+        hashlife_expand(hl);
+    }
+
+    size_t nnodes = hl->nnodes;
+    int64_t quarter = (int64_t) 1 << (hl->root->level - 2);
+    hl->root = hashlife_result(hl, hl->root);
+    hl->step_nodes = hl->nnodes - nnodes;
+    hl->origin_y += quarter;
+    hl->origin_x += quarter;
+
+    return UINT64_C(1) << hl->step_exp;
+}
+
+// sets the live cells of a node of level 6 or less in rows, with its top
+// left at bit x of row y
+static void node_rows(Node const *node, int y, int x, uint64_t *rows)
+{
+    if (node->population == 0) {
+        return;
+    }
+    if (node->level == 0) {
+        rows[y] |= UINT64_C(1) << x;
+        return;
+    }
+
+    int half = 1 << (node->level - 1);
+    node_rows(node->nw, y, x, rows);
+    node_rows(node->ne, y, x + half, rows);
+    node_rows(node->sw, y + half, x, rows);
+    node_rows(node->se, y + half, x + half, rows);
+}
+
+// generation hash of a node of level 6 or more with its top left at (0, 0),
+// from its rows at level 6 and its quadrants' above. nodes are canonical,
+// so each is only hashed once
+static uint64_t node_generation_hash(Node *node)
+{
+    if (node->population == 0) {
+        return 0;
+    }
+    if (node->hashed) {
+        return node->hash;
+    }
+
+    uint64_t hash = 0;
+    if (node->level == 6)
+    {
+        uint64_t rows[64] = {0};
+        node_rows(node, 0, 0, rows);
+        uint64_t power = 1;
+        for (int r = 0; r < 64; r++) {
+            hash += power * word_mix(rows[r]);
+            power *= HASH_ROW;
+        }
+    }
+    else
+    {
+        int k = node->level - 1;
+        hash = node_generation_hash(node->nw)
+            + word_powers[k - 6] * node_generation_hash(node->ne)
+            + row_powers[k] * (node_generation_hash(node->sw)
+                + word_powers[k - 6] * node_generation_hash(node->se));
+    }
+
+    node->hash = hash;
+    node->hashed = true;
+    return hash;
+}
+
+// generation hash of the universe. the root's left edge is on a word
+static uint64_t hashlife_hash(HashLife const *hl)
+{
+    return word_power(hl->origin_y, hl->origin_x / 64) * node_generation_hash(hl->root);
+}
+
+// whether the cell at (y, x) from node's top left is alive
+static bool node_cell(Node const *node, int64_t y, int64_t x)
+{
+    int64_t size = (int64_t) 1 << node->level;
+    if (y < 0 || x < 0 || y >= size || x >= size) {
+        return false;
+    }
+
+    while (node->level > 0 && node->population > 0)
+    {
+        int64_t half = (int64_t) 1 << (node->level - 1);
+        bool south = y >= half;
+        bool east = x >= half;
+        node = south ? (east ? node->se : node->sw) : (east ? node->ne : node->nw);
+        y -= south ? half : 0;
+        x -= east ? half : 0;
+    }
+    return node->population > 0;
+}
+
+// cells x to x + 63 of row y from node's top left, for any x
+static uint64_t node_row(Node const *node, int64_t y, int64_t x)
+{
+    int64_t size = (int64_t) 1 << node->level;
+    if (node->population == 0 || y < 0 || y >= size || x >= size || x + 64 <= 0) {
+        return 0;
+    }
+    if (node->level == 0) {
+        return UINT64_C(1) << -x;
+    }
+
+    int64_t half = size / 2;
+    bool south = y >= half;
+    y -= south ? half : 0;
+    return node_row(south ? node->sw : node->nw, y, x)
+        | node_row(south ? node->se : node->ne, y, x - half);
+}
+
+// whether any cell is alive in [y0, y1) by [x0, x1) from node's top left
+static bool node_any(Node const *node, int64_t y0, int64_t x0, int64_t y1, int64_t x1)
+{
+    int64_t size = (int64_t) 1 << node->level;
+    if (node->population == 0 || y1 <= 0 || x1 <= 0 || y0 >= size || x0 >= size) {
+        return false;
+    }
+    if (y0 <= 0 && x0 <= 0 && y1 >= size && x1 >= size) {
+        return true;
+    }
+
+    int64_t half = size / 2;
+    return node_any(node->nw, y0, x0, y1, x1)
+        || node_any(node->ne, y0, x0 - half, y1, x1 - half)
+        || node_any(node->sw, y0 - half, x0, y1 - half, x1)
+        || node_any(node->se, y0 - half, x0 - half, y1 - half, x1 - half);
+}
+
+// the level 6 node at (y, x) from node's top left, both multiples of 64 and
+// inside it, or the empty node above it that holds it
+static Node const *node_block(Node const *node, int64_t y, int64_t x)
+{
+    while (node->level > 6 && node->population > 0)
+    {
+        int64_t half = (int64_t) 1 << (node->level - 1);
+        bool south = y >= half;
+        bool east = x >= half;
+        node = south ? (east ? node->se : node->sw) : (east ? node->ne : node->nw);
+        y -= south ? half : 0;
+        x -= east ? half : 0;
+    }
+    return node;
+}
+
+// node with the level 6 node at (y, x) from its top left, both multiples of
+// 64 and inside it, replaced by block. nodes nothing changes in are kept
+static Node *node_set_block(HashLife *hl, Node *node, int64_t y, int64_t x, Node *block)
+{
+    if (node->level == 6) {
+        return block;
+    }
+
+    int64_t half = (int64_t) 1 << (node->level - 1);
+    bool south = y >= half;
+    bool east = x >= half;
+    Node *quadrant = south ? (east ? node->se : node->sw) : (east ? node->ne : node->nw);
+    Node *replaced = node_set_block(hl, quadrant, y - (south ? half : 0),
+            x - (east ? half : 0), block);
+
+    if (replaced == quadrant) {
+        return node;
+    }
+    return hashlife_node(hl,
+        !south && !east ? replaced : node->nw,
+        !south && east ? replaced : node->ne,
+        south && !east ? replaced : node->sw,
+        south && east ? replaced : node->se);
+}
+
+// node of the given level, 6 or less, of the cells from bit x of row y of rows
+static Node *hashlife_rows_node(HashLife *hl, uint64_t const *rows, int level, int y, int x)
+{
+    if (level == 0) {
+        return &hl->cells[(rows[y] >> x) & 1];
+    }
+
+    int half = 1 << (level - 1);
+    return hashlife_node(hl,
+        hashlife_rows_node(hl, rows, level - 1, y, x),
+        hashlife_rows_node(hl, rows, level - 1, y, x + half),
+        hashlife_rows_node(hl, rows, level - 1, y + half, x),
+        hashlife_rows_node(hl, rows, level - 1, y + half, x + half));
+}
+
+struct Tile{
+    int ty;
+    int tx;
+    // rows of the current and the next generation, indexed by Universe.cur
+    uint64_t rows[2][UNIVERSE_TILE];
+    // whether the tile or a neighbour changed in the last step, so the
+    // tile must be stepped. otherwise both generations hold the same cells
+    bool dirty;
+    bool dirty_next;
+    Tile *next;
+};
+
+struct Universe{
+    Tile **table;
+    size_t table_size;
+    size_t ntiles;
+    int cur;
+    // scratch list of every tile, for stepping
+    Tile **list;
+    size_t list_size;
+};
+
+// index of the lowest set bit of a nonzero word
+static int lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// index of the highest set bit of a nonzero word
+static int highest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(word);
+#else
+    int bit = 63;
+    while (!(word >> 63)) {
+        word <<= 1;
+        bit--;
+    }
+    return bit;
+#endif
+}
+
+static int popcount(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// rounds v / d down, also for negative v
+int floor_div(int v, int d)
+{
+    return v >= 0 ? v / d : -1 - (-1 - v) / d;
+}
+
+// expands the seed into the generator's state with splitmix64
+void rng_seed(Rng *rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t z = (seed += UINT64_C(0x9e3779b97f4a7c15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+uint64_t rng_next(Rng *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+// 64 random bits, each set with chance percent (to 16 binary places).
+// going up the binary digits of the chance, ORing a random word in for a
+// one halves the chance of a bit being clear and ANDing one in for a zero
+// halves the chance of it being set, so a chance with few binary places
+// costs few words: one for 50%, two for 25% or 75%
+uint64_t rng_chance(Rng *rng, int chance)
+{
+    unsigned threshold = (unsigned) ((chance * 65536 + 50) / 100);
+    if (threshold == 0) {
+        return 0;
+    }
+    if (threshold >= 65536) {
+        return ~UINT64_C(0);
+    }
+
+    uint64_t bits = 0;
+    for (int place = lowest_bit(threshold); place < 16; place++) {
+        bits = (threshold >> place) & 1 ? bits | rng_next(rng) : bits & rng_next(rng);
+    }
+    return bits;
+}
+
+static size_t tile_hash(int ty, int tx)
+{
+    uint64_t h = (uint32_t) ty * UINT64_C(0x9E3779B97F4A7C15) ^ (uint32_t) tx;
+    h *= UINT64_C(0xBF58476D1CE4E5B9);
+    return (size_t) (h ^ (h >> 31));
+}
+
+static Universe *universe_new(void)
+{
+    Universe *u = malloc(sizeof *u);
+    *u = (Universe){.table_size = 1 << 10};
+    u->table = calloc(u->table_size, sizeof *(u->table));
+
+    return u;
+}
+
+static void universe_clear(Universe *u)
+{
+    for (size_t i = 0; i < u->table_size; i++)
+    {
+        while (u->table[i])
+        {
+            Tile *next = u->table[i]->next;
+            free(u->table[i]);
+            u->table[i] = next;
+        }
+    }
+    u->ntiles = 0;
+}
+
+static void universe_destroy(Universe *u)
+{
+    universe_clear(u);
+    free(u->table);
+    free(u->list);
+    free(u);
+}
+
+static Tile *universe_find(Universe const *u, int ty, int tx)
+{
+    for (Tile *tile = u->table[tile_hash(ty, tx) & (u->table_size - 1)]; tile; tile = tile->next)
+    {
+        if (tile->ty == ty && tile->tx == tx) {
+            return tile;
+        }
+    }
+    return NULL;
+}
+
+// the tile at (ty, tx), allocated empty if there is none
+static Tile *universe_tile(Universe *u, int ty, int tx)
+{
+    Tile *tile = universe_find(u, ty, tx);
+    if (tile) {
+        return tile;
+    }
+
+    if (u->ntiles >= u->table_size)
+    {
+        size_t table_size = u->table_size * 2;
+        Tile **table = calloc(table_size, sizeof *table);
+        for (size_t i = 0; i < u->table_size; i++)
+        {
+            while (u->table[i])
+            {
+                Tile *moved = u->table[i];
+                size_t h = tile_hash(moved->ty, moved->tx) & (table_size - 1);
+                u->table[i] = moved->next;
+                moved->next = table[h];
+                table[h] = moved;
+            }
+        }
+        free(u->table);
+        u->table = table;
+        u->table_size = table_size;
+    }
+
+    size_t h = tile_hash(ty, tx) & (u->table_size - 1);
+    tile = calloc(1, sizeof *tile);
+    tile->ty = ty;
+    tile->tx = tx;
+    tile->dirty = true;
+    tile->next = u->table[h];
+    u->table[h] = tile;
+    u->ntiles++;
+
+    return tile;
+}
+
+static void universe_remove(Universe *u, Tile *tile)
+{
+    Tile **link = &u->table[tile_hash(tile->ty, tile->tx) & (u->table_size - 1)];
+    while (*link != tile) {
+        link = &(*link)->next;
+    }
+    *link = tile->next;
+    free(tile);
+    u->ntiles--;
+}
+
+// gathers every tile into u->list and returns how many there are
+static size_t universe_list(Universe *u)
+{
+    if (u->list_size < u->ntiles)
+    {
+        u->list_size = u->ntiles * 2;
+        u->list = realloc(u->list, u->list_size * sizeof *(u->list));
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < u->table_size; i++) {
+        for (Tile *tile = u->table[i]; tile; tile = tile->next) {
+            u->list[n++] = tile;
+        }
+    }
+    return n;
+}
+
+// cells x to x + 63 of row y, for x a multiple of 64
+static uint64_t universe_word(Universe const *u, int y, int x)
+{
+    Tile const *tile = universe_find(u, floor_div(y, UNIVERSE_TILE), floor_div(x, UNIVERSE_TILE));
+    return tile ? tile->rows[u->cur][y - floor_div(y, UNIVERSE_TILE) * UNIVERSE_TILE] : 0;
+}
+
+static bool universe_get(Universe const *u, int y, int x)
+{
+    int tx = floor_div(x, UNIVERSE_TILE);
+    return (universe_word(u, y, tx * UNIVERSE_TILE) >> (x - tx * UNIVERSE_TILE)) & 1;
+}
+
+static void universe_set(Universe *u, int y, int x, bool alive)
+{
+    int ty = floor_div(y, UNIVERSE_TILE);
+    int tx = floor_div(x, UNIVERSE_TILE);
+    Tile *tile = alive ? universe_tile(u, ty, tx) : universe_find(u, ty, tx);
+    if (!tile) {
+        return;
+    }
+
+    uint64_t *word = &tile->rows[u->cur][y - ty * UNIVERSE_TILE];
+    uint64_t bit = UINT64_C(1) << (x - tx * UNIVERSE_TILE);
+    if (alive) {
+        *word |= bit;
+    }
+    else {
+        *word &= ~bit;
+    }
+    tile->dirty = true;
+}
+
+// cell bounds of the allocated tiles, [y0, y1) by [x0, x1)
+static void universe_bounds(Universe const *u, int *y0, int *x0, int *y1, int *x1)
+{
+    bool any = false;
+    int ty0 = 0, tx0 = 0, ty1 = 0, tx1 = 0;
+
+    for (size_t i = 0; i < u->table_size; i++)
+    {
+        for (Tile const *tile = u->table[i]; tile; tile = tile->next)
+        {
+            ty0 = !any || tile->ty < ty0 ? tile->ty : ty0;
+            tx0 = !any || tile->tx < tx0 ? tile->tx : tx0;
+            ty1 = !any || tile->ty + 1 > ty1 ? tile->ty + 1 : ty1;
+            tx1 = !any || tile->tx + 1 > tx1 ? tile->tx + 1 : tx1;
+            any = true;
+        }
+    }
+
+    *y0 = ty0 * UNIVERSE_TILE;
+    *x0 = tx0 * UNIVERSE_TILE;
+    *y1 = ty1 * UNIVERSE_TILE;
+    *x1 = tx1 * UNIVERSE_TILE;
+}
+
+// whether any cell of tile is alive in the size by size square from (y, x)
+static bool tile_any(Universe const *u, Tile const *tile, int y, int x, int size)
+{
+    int64_t top = (int64_t) tile->ty * UNIVERSE_TILE;
+    int64_t left = (int64_t) tile->tx * UNIVERSE_TILE;
+    int64_t y1 = (int64_t) y + size;
+    int64_t x1 = (int64_t) x + size;
+    if (top >= y1 || left >= x1 || top + UNIVERSE_TILE <= y || left + UNIVERSE_TILE <= x) {
+        return false;
+    }
+
+    uint64_t mask = ~UINT64_C(0);
+    if (x > left) {
+        mask <<= x - left;
+    }
+    if (x1 < left + UNIVERSE_TILE) {
+        mask &= (UINT64_C(1) << (x1 - left)) - 1;
+    }
+    for (int64_t r = y > top ? y - top : 0; r < UNIVERSE_TILE && top + r < y1; r++)
+    {
+        if (tile->rows[u->cur][r] & mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// whether any cell is alive in the size by size square from (y, x). looks
+// up each tile position the square covers, or goes through every tile when
+// there are fewer of those
+static bool universe_any(Universe const *u, int y, int x, int size)
+{
+    int ty0 = floor_div(y, UNIVERSE_TILE);
+    int tx0 = floor_div(x, UNIVERSE_TILE);
+    int span = size / UNIVERSE_TILE + 2;
+
+    if ((int64_t) span * span > (int64_t) u->ntiles)
+    {
+        for (size_t i = 0; i < u->table_size; i++) {
+            for (Tile const *tile = u->table[i]; tile; tile = tile->next) {
+                if (tile_any(u, tile, y, x, size)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    for (int ty = ty0; ty < ty0 + span; ty++)
+    {
+        for (int tx = tx0; tx < tx0 + span; tx++)
+        {
+            Tile const *tile = universe_find(u, ty, tx);
+            if (tile && tile_any(u, tile, y, x, size)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void universe_invalidate(Universe *u)
+{
+    for (size_t i = 0; i < u->table_size; i++) {
+        for (Tile *tile = u->table[i]; tile; tile = tile->next) {
+            tile->dirty = true;
+        }
+    }
+}
+
+// allocates a zeroed grid buffer including padding
+static uint64_t *grid_new(Model const *model)
+{
+    return calloc((size_t) (model->nrows + 2) * model->stride, sizeof(uint64_t));
+}
+
+// first word of row y in grid; y may be -1 or nrows for the padding rows
+static uint64_t *grid_row(uint64_t *grid, Model const *model, int y)
+{
+    return grid + (size_t) (y + 1) * model->stride + 1;
+}
+
+// next state of 64 cells at once (or LIFE_LANES * 64 for vector T) under
+// B3/S23 from the cells themselves (c), their west and east neighbours in
+// the same row (w, e) and the three aligned words of the rows above (aw, a,
+// ae) and below (bw, b, be). neighbours are summed with bitwise adders into
+// count bits t0, t1, t2; a count of 8 has t1 clear so its carry can be
+// dropped. birth and survive are only there to match the rule kernels
+#define LIFE_WORD_FN(name, T) \
+    static inline T name(T aw, T a, T ae, T w, T c, T e, T bw, T b, T be, \
+            unsigned birth, unsigned survive) \
+    { \
+        (void) birth; \
+        (void) survive; \
+        T a0 = aw ^ a ^ ae; \
+        T a1 = (aw & a) | (ae & (aw ^ a)); \
+        T m0 = w ^ e; \
+        T m1 = w & e; \
+        T b0 = bw ^ b ^ be; \
+        T b1 = (bw & b) | (be & (bw ^ b)); \
+        T t0 = a0 ^ m0 ^ b0; \
+        T k0 = (a0 & m0) | (b0 & (a0 ^ m0)); \
+        T u = a1 ^ m1 ^ b1; \
+        T v = (a1 & m1) | (b1 & (a1 ^ m1)); \
+        T t1 = u ^ k0; \
+        T t2 = v ^ (u & k0); \
+        return t1 & ~t2 & (t0 | c); \
+    }
+
+// the same for any outer totalistic rule, bit n of birth and survive
+// being set when n live neighbours make a cell born or survive. the count
+// is summed into four bit planes and each count the rule cares about is
+// matched against them. with constant masks all the tests fold away and
+// the kernel holds only the terms the rule needs; the fourth plane only
+// matters to rules that tell 0 and 8 apart
+#define RULE_WORD_FN(name, T) \
+    static inline __attribute__((always_inline)) T name(T aw, T a, T ae, \
+            T w, T c, T e, T bw, T b, T be, unsigned birth, unsigned survive) \
+    { \
+        T a0 = aw ^ a ^ ae; \
+        T a1 = (aw & a) | (ae & (aw ^ a)); \
+        T m0 = w ^ e; \
+        T m1 = w & e; \
+        T b0 = bw ^ b ^ be; \
+        T b1 = (bw & b) | (be & (bw ^ b)); \
+        T t0 = a0 ^ m0 ^ b0; \
+        T k0 = (a0 & m0) | (b0 & (a0 ^ m0)); \
+        T u = a1 ^ m1 ^ b1; \
+        T v = (a1 & m1) | (b1 & (a1 ^ m1)); \
+        T t1 = u ^ k0; \
+        T t2 = v ^ (u & k0); \
+        T t3 = v & u & k0; \
+        bool wide = ((birth | survive) & 0x101) != 0; \
+        T next = c & ~c; \
+        for (int n = 0; n <= 8; n++) \
+        { \
+            bool born = (birth >> n) & 1; \
+            bool stays = (survive >> n) & 1; \
+            if (!born && !stays) { \
+                continue; \
+            } \
+            T eq = (n & 1 ? t0 : ~t0) & (n & 2 ? t1 : ~t1) & (n & 4 ? t2 : ~t2); \
+            if (wide) { \
+                eq &= n & 8 ? t3 : ~t3; \
+            } \
+            next |= born && stays ? eq : born ? eq & ~c : eq & c; \
+        } \
+        return next; \
+    }
+
+LIFE_WORD_FN(life_word, uint64_t)
+RULE_WORD_FN(rule_word, uint64_t)
+
+// with GCC vector extensions several words are stepped per instruction,
+// as many as the registers of the targeted instruction set hold
+#if defined(__GNUC__)
+#if defined(__AVX512F__)
+#define LIFE_LANES 8
+#elif defined(__AVX2__)
+#define LIFE_LANES 4
+#else
+#define LIFE_LANES 2
+#endif
+
+typedef uint64_t Lanes __attribute__((vector_size(LIFE_LANES * sizeof(uint64_t))));
+
+LIFE_WORD_FN(life_lanes, Lanes)
+RULE_WORD_FN(rule_lanes, Lanes)
+
+static inline Lanes lanes_load(uint64_t const *p)
+{
+    Lanes v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+#define STEP_LANES(kernel, birth, survive) \
+    for (; i + LIFE_LANES <= nwords; i += LIFE_LANES) \
+    { \
+        Lanes a = lanes_load(above + i); \
+        Lanes c = lanes_load(row + i); \
+        Lanes b = lanes_load(below + i); \
+        \
+        Lanes next = kernel##_lanes( \
+            (a << 1) | (lanes_load(above + i - 1) >> 63), a, \
+            (a >> 1) | (lanes_load(above + i + 1) << 63), \
+            (c << 1) | (lanes_load(row + i - 1) >> 63), c, \
+            (c >> 1) | (lanes_load(row + i + 1) << 63), \
+            (b << 1) | (lanes_load(below + i - 1) >> 63), b, \
+            (b >> 1) | (lanes_load(below + i + 1) << 63), \
+            birth, survive); \
+        Lanes flipped = next ^ c; \
+        memcpy(out + i, &next, sizeof next); \
+        memcpy(changed + i, &flipped, sizeof flipped); \
+    }
+#else
+#define STEP_LANES(kernel, birth, survive)
+#endif
+
+// defines a RowFn stepping with the given kernel (life or rule) and rule
+// masks, which are constants for the specialized rules
+#define STEP_ROW_FN(name, kernel, birth, survive) \
+    static void name(uint64_t const *above, uint64_t const *row, uint64_t const *below, \
+            uint64_t *out, uint64_t *changed, int nwords, Rule const *rule) \
+    { \
+        (void) rule; \
+        int i = 0; \
+        STEP_LANES(kernel, birth, survive) \
+        \
+        for (; i < nwords; i++) \
+        { \
+            uint64_t a = above[i]; \
+            uint64_t c = row[i]; \
+            uint64_t b = below[i]; \
+            \
+            out[i] = kernel##_word( \
+                (a << 1) | (above[i - 1] >> 63), a, (a >> 1) | (above[i + 1] << 63), \
+                (c << 1) | (row[i - 1] >> 63), c, (c >> 1) | (row[i + 1] << 63), \
+                (b << 1) | (below[i - 1] >> 63), b, (b >> 1) | (below[i + 1] << 63), \
+                birth, survive); \
+            changed[i] = out[i] ^ c; \
+        } \
+    }
+
+STEP_ROW_FN(step_row_life, life, 0, 0)
+STEP_ROW_FN(step_row_highlife, rule, 0x048, 0x00c)
+STEP_ROW_FN(step_row_day_night, rule, 0x1c8, 0x1d8)
+STEP_ROW_FN(step_row_seeds, rule, 0x004, 0x000)
+STEP_ROW_FN(step_row_replicator, rule, 0x0aa, 0x0aa)
+STEP_ROW_FN(step_row_morley, rule, 0x148, 0x034)
+STEP_ROW_FN(step_row_no_death, rule, 0x008, 0x1ff)
+STEP_ROW_FN(step_row_34_life, rule, 0x018, 0x018)
+STEP_ROW_FN(step_row_diamoeba, rule, 0x1e8, 0x1e0)
+STEP_ROW_FN(step_row_2x2, rule, 0x048, 0x026)
+// any other rule, tested against its masks at run time
+STEP_ROW_FN(step_row_generic, rule, rule->birth, rule->survive)
+
+// rules with a kernel of their own
+static const struct {
+    char const *name;
+    Rule rule;
+    RowFn *step_row;
+} KNOWN_RULES[] = {
+    {"B3/S23", {0x008, 0x00c}, step_row_life},
+    {"B36/S23", {0x048, 0x00c}, step_row_highlife},
+    {"B3678/S34678", {0x1c8, 0x1d8}, step_row_day_night},
+    {"B2/S", {0x004, 0x000}, step_row_seeds},
+    {"B1357/S1357", {0x0aa, 0x0aa}, step_row_replicator},
+    {"B368/S245", {0x148, 0x034}, step_row_morley},
+    {"B3/S012345678", {0x008, 0x1ff}, step_row_no_death},
+    {"B34/S34", {0x018, 0x018}, step_row_34_life},
+    {"B35678/S5678", {0x1e8, 0x1e0}, step_row_diamoeba},
+    {"B36/S125", {0x048, 0x026}, step_row_2x2},
+};
+
+static RowFn *rule_step_row(Rule const *rule)
+{
+    for (size_t i = 0; i < sizeof KNOWN_RULES / sizeof *KNOWN_RULES; i++)
+    {
+        Rule const *known = &KNOWN_RULES[i].rule;
+        if (known->birth == rule->birth && known->survive == rule->survive) {
+            return KNOWN_RULES[i].step_row;
+        }
+    }
+    return step_row_generic;
+}
+
+// writes a rule as a B/S rulestring
+void rule_format(Rule const *rule, char *text, size_t size)
+{
+    int len = snprintf(text, size, "B");
+    for (int n = 0; n <= 8; n++) {
+        if ((rule->birth >> n) & 1) {
+            len += snprintf(text + len, size - len, "%d", n);
+        }
+    }
+    len += snprintf(text + len, size - len, "/S");
+    for (int n = 0; n <= 8; n++) {
+        if ((rule->survive >> n) & 1) {
+            len += snprintf(text + len, size - len, "%d", n);
+        }
+    }
+}
+
+// adds the neighbour counts in [begin, end) to mask
+static bool parse_counts(char const *begin, char const *end, unsigned *mask)
+{
+    for (char const *p = begin; p < end; p++)
+    {
+        if (*p < '0' || *p > '8') {
+            return false;
+        }
+        *mask |= 1u << (*p - '0');
+    }
+    return true;
+}
+
+// parses a rulestring, Bx/Sy with the halves in either order and in either
+// case, or the older y/x with survival counts first
+bool parse_rule(char const *arg, Rule *rule)
+{
+    char const *slash = strchr(arg, '/');
+    if (!slash) {
+        return false;
+    }
+    char const *end = slash + strlen(slash);
+
+    Rule parsed = {0, 0};
+    char first = (char) toupper((unsigned char) arg[0]);
+    char second = (char) toupper((unsigned char) slash[1]);
+    if (first == 'B' && second == 'S') {
+        if (!parse_counts(arg + 1, slash, &parsed.birth)
+            || !parse_counts(slash + 2, end, &parsed.survive))
+        {
+            return false;
+        }
+    }
+    else if (first == 'S' && second == 'B') {
+        if (!parse_counts(arg + 1, slash, &parsed.survive)
+            || !parse_counts(slash + 2, end, &parsed.birth))
+        {
+            return false;
+        }
+    }
+    else if (!parse_counts(arg, slash, &parsed.survive)
+        || !parse_counts(slash + 1, end, &parsed.birth))
+    {
+        return false;
+    }
+
+    *rule = parsed;
+    return true;
+}
+
+// cell x of a grid row, for x from -1 to ncols, so including the ghost
+// border
+static bool grid_cell(uint64_t const *row, int x)
+{
+    return (row[(x + 64) / 64 - 1] >> ((x + 64) % 64)) & 1;
+}
+
+static void grid_cell_set(uint64_t *row, int x, bool alive)
+{
+    uint64_t *word = &row[(x + 64) / 64 - 1];
+    int bit = (x + 64) % 64;
+    *word = (*word & ~(UINT64_C(1) << bit)) | ((uint64_t) alive << bit);
+}
+
+// a bounded model with the defaults, or an empty one for a universe
+static Model *model_alloc(int nrows, int ncols, Engine engine)
+{
+    Model *model = malloc(sizeof *model);
+    model->nrows = nrows;
+    model->ncols = ncols;
+    model->nwords = (model->ncols + 63) / 64;
+    model->stride = model->nwords + 2;
+    model->tail_mask = model->ncols % 64 == 0
+        ? ~UINT64_C(0)
+        : (UINT64_C(1) << (model->ncols % 64)) - 1;
+    model->grid = grid_new(model);
+    model->next = grid_new(model);
+    model->changed = malloc(((size_t) model->nwords + 1) * sizeof(uint64_t));
+    model->ntile_rows = (model->nrows + TILE_ROWS - 1) / TILE_ROWS;
+    model->tiles = calloc((size_t) model->ntile_rows * model->nwords, sizeof(bool));
+    model->tiles_next = calloc((size_t) model->ntile_rows * model->nwords, sizeof(bool));
+    model->engine = engine;
+    model->boundary = BOUNDARY_DEAD;
+    model->rule = LIFE_RULE;
+    model->step_row = step_row_life;
+    model->pool = NULL;
+    model->hashlife = NULL;
+    model->universe = NULL;
+    model->generation = 0;
+    model->hash = 0;
+
+    return model;
+}
+
+// also picks the rule's specialized row kernel, if it has one
+static void model_set_rule(Model *model, Rule const *rule)
+{
+    model->rule = *rule;
+    model->step_row = rule_step_row(rule);
+    if (model->hashlife) {
+        hashlife_set_rule(model->hashlife, rule);
+    }
+}
+
+Model *model_new(ModelConfig const *config)
+{
+    pthread_once(&hash_once, hash_init);
+
+    Model *model = model_alloc(config->unbounded ? 0 : config->nrows,
+            config->unbounded ? 0 : config->ncols, config->engine);
+    model_set_rule(model, &config->rule);
+    model->boundary = config->boundary;
+    if (config->unbounded) {
+        model->universe = universe_new();
+    }
+    if (config->nthreads > 1) {
+        model->pool = pool_new(config->nthreads);
+    }
+    if (config->engine == ENGINE_HASHLIFE) {
+        model->hashlife = hashlife_new(config->hashlife_nodes, config->step_exp, &config->rule);
+    }
+    return model;
+}
+
+void model_destroy(Model *model)
+{
+    if (model->pool) {
+        pool_destroy(model->pool);
+    }
+    if (model->hashlife) {
+        hashlife_destroy(model->hashlife);
+    }
+    if (model->universe) {
+        universe_destroy(model->universe);
+    }
+    free(model->grid);
+    free(model->next);
+    free(model->changed);
+    free(model->tiles);
+    free(model->tiles_next);
+    free(model);
+}
+
+
+static bool out_of_bounds(int celly, int cellx, Model const *model) {
+
+    return celly < 0 || celly >= model->nrows
+            || cellx < 0 || cellx >= model->ncols;
+}
+
+// the quadtree an unbounded hashlife model keeps its cells in, or NULL when
+// the cells are in the grid or the tiles. such a model's universe only holds
+// tiles staged for writing, whose blocks are empty in the tree
+static HashLife *model_tree(Model const *model)
+{
+    return model->universe ? model->hashlife : NULL;
+}
+
+// the staged tile at (ty, tx) of an unbounded hashlife model, moving the
+// tree's cells there into it first if there is none. writes go to tiles, as
+// rebuilding the tree's path to a cell for each one is slow
+static Tile *model_stage_tile(Model *model, int ty, int tx)
+{
+    HashLife *hl = model->hashlife;
+    Universe *u = model->universe;
+    Tile *tile = universe_find(u, ty, tx);
+    if (tile) {
+        return tile;
+    }
+
+    tile = universe_tile(u, ty, tx);
+    int64_t size = (int64_t) 1 << hl->root->level;
+    int64_t y = (int64_t) ty * UNIVERSE_TILE - hl->origin_y;
+    int64_t x = (int64_t) tx * UNIVERSE_TILE - hl->origin_x;
+    if (y < 0 || x < 0 || y >= size || x >= size) {
+        return tile;
+    }
+
+    Node const *block = node_block(hl->root, y, x);
+    if (block->population > 0) {
+        node_rows(block, 0, 0, tile->rows[u->cur]);
+        hl->root = node_set_block(hl, hl->root, y, x, hashlife_empty(hl, 6));
+    }
+    return tile;
+}
+
+// moves the staged tiles of an unbounded hashlife model back into its tree,
+// growing the root to hold them, then collects the nodes left behind once
+// there are enough. called once per batch of writes, before the tree is read
+// as a whole
+static void model_flush_tree(Model *model)
+{
+    HashLife *hl = model->hashlife;
+    Universe *u = model->universe;
+    if (u->ntiles == 0) {
+        return;
+    }
+
+    size_t n = universe_list(u);
+    for (size_t i = 0; i < n; i++)
+    {
+        Tile const *tile = u->list[i];
+        Node *block = hashlife_rows_node(hl, tile->rows[u->cur], 6, 0, 0);
+        if (block->population == 0) {
+            continue;
+        }
+
+        int64_t y = (int64_t) tile->ty * UNIVERSE_TILE;
+        int64_t x = (int64_t) tile->tx * UNIVERSE_TILE;
+        while (y < hl->origin_y || y >= hl->origin_y + ((int64_t) 1 << hl->root->level)
+            || x < hl->origin_x || x >= hl->origin_x + ((int64_t) 1 << hl->root->level))
+        {
+            hashlife_expand(hl);
+        }
+        hl->root = node_set_block(hl, hl->root, y - hl->origin_y, x - hl->origin_x, block);
+    }
+    universe_clear(u);
+
+    if (hl->nnodes > hl->collect_at) {
+        hashlife_collect(hl);
+    }
+}
+
+// whether the model has a cell at (celly, cellx)
+bool model_contains(Model const *model, int celly, int cellx)
+{
+    return model->universe || !out_of_bounds(celly, cellx, model);
+}
+
+// cells outside a bounded grid read as dead
+bool model_get(Model const *model, int celly, int cellx)
+{
+    HashLife const *tree = model_tree(model);
+    if (tree && node_cell(tree->root, celly - tree->origin_y, cellx - tree->origin_x)) {
+        return true;
+    }
+    if (model->universe) {
+        return universe_get(model->universe, celly, cellx);
+    }
+    if (out_of_bounds(celly, cellx, model)) {
+        return false;
+    }
+
+    uint64_t const *row = grid_row(model->grid, model, celly);
+    return (row[cellx / 64] >> (cellx % 64)) & 1;
+}
+
+void model_set(Model *model, int celly, int cellx, bool alive)
+{
+    if (model_tree(model))
+    {
+        int x = floor_div(cellx, 64) * 64;
+        uint64_t bit = UINT64_C(1) << (cellx - x);
+        model_set_word(model, celly, x, bit, alive ? bit : 0);
+        return;
+    }
+    if (model->universe) {
+        universe_set(model->universe, celly, cellx, alive);
+        return;
+    }
+    if (out_of_bounds(celly, cellx, model)) {
+        return;
+    }
+
+    uint64_t *word = &grid_row(model->grid, model, celly)[cellx / 64];
+    uint64_t bit = UINT64_C(1) << (cellx % 64);
+
+    if (alive) {
+        *word |= bit;
+    }
+    else {
+        *word &= ~bit;
+    }
+}
+
+// cells x to x + 63 of row y, for x a multiple of 64
+uint64_t model_word(Model const *model, int y, int x)
+{
+    HashLife const *tree = model_tree(model);
+    if (tree) {
+        return node_row(tree->root, y - tree->origin_y, x - tree->origin_x)
+            | universe_word(model->universe, y, x);
+    }
+    if (model->universe) {
+        return universe_word(model->universe, y, x);
+    }
+    if (out_of_bounds(y, x, model)) {
+        return 0;
+    }
+    return grid_row(model->grid, model, y)[x / 64];
+}
+
+// sets the cells of mask in the word at row y, columns x to x + 63 (x a
+// multiple of 64) to those of bits
+void model_set_word(Model *model, int y, int x, uint64_t mask, uint64_t bits)
+{
+    if (model->universe)
+    {
+        Universe *u = model->universe;
+        int ty = floor_div(y, UNIVERSE_TILE);
+        int tx = floor_div(x, UNIVERSE_TILE);
+        Tile *tile;
+        if (model_tree(model)) {
+            // only stage the tree's block when a cell changes
+            tile = bits & mask || model_word(model, y, x) & mask
+                ? model_stage_tile(model, ty, tx) : NULL;
+        }
+        else {
+            tile = bits & mask ? universe_tile(u, ty, tx) : universe_find(u, ty, tx);
+        }
+        if (tile) {
+            uint64_t *word = &tile->rows[u->cur][y - ty * UNIVERSE_TILE];
+            *word = (*word & ~mask) | (bits & mask);
+            tile->dirty = true;
+        }
+        return;
+    }
+    if (out_of_bounds(y, x, model)) {
+        return;
+    }
+
+    if (x / 64 == model->nwords - 1) {
+        mask &= model->tail_mask;
+    }
+    uint64_t *word = &grid_row(model->grid, model, y)[x / 64];
+    *word = (*word & ~mask) | (bits & mask);
+}
+
+// whether any cell is alive in the size by size square from (y, x)
+bool model_block_alive(Model const *model, int y, int x, int size)
+{
+    HashLife const *tree = model_tree(model);
+    if (tree) {
+        return node_any(tree->root, y - tree->origin_y, x - tree->origin_x,
+                (int64_t) y + size - tree->origin_y, (int64_t) x + size - tree->origin_x)
+            || universe_any(model->universe, y, x, size);
+    }
+    if (size == 1) {
+        return model_get(model, y, x);
+    }
+
+    for (int j = y; j < y + size; j++)
+    {
+        int i = x;
+        while (i < x + size)
+        {
+            int word_x = floor_div(i, 64) * 64;
+            int count = word_x + 64 < x + size ? word_x + 64 - i : x + size - i;
+            uint64_t mask = count == 64 ? ~UINT64_C(0) : (UINT64_C(1) << count) - 1;
+
+            if (model_word(model, j, word_x) & (mask << (i - word_x))) {
+                return true;
+            }
+            i += count;
+        }
+    }
+    return false;
+}
+
+static int clamp_int(int64_t v)
+{
+    return v < INT_MIN ? INT_MIN : v > INT_MAX ? INT_MAX : (int) v;
+}
+
+// cell bounds of everything alive, [y0, y1) by [x0, x1), possibly loose
+void model_bounds(Model const *model, int *y0, int *x0, int *y1, int *x1)
+{
+    HashLife const *tree = model_tree(model);
+    if (tree)
+    {
+        // the root's extent, as far as it is in range, and the staged tiles'
+        int64_t size = (int64_t) 1 << tree->root->level;
+        *y0 = clamp_int(tree->origin_y);
+        *x0 = clamp_int(tree->origin_x);
+        *y1 = clamp_int(tree->origin_y + size);
+        *x1 = clamp_int(tree->origin_x + size);
+        if (model->universe->ntiles > 0)
+        {
+            int ty0, tx0, ty1, tx1;
+            universe_bounds(model->universe, &ty0, &tx0, &ty1, &tx1);
+            *y0 = ty0 < *y0 ? ty0 : *y0;
+            *x0 = tx0 < *x0 ? tx0 : *x0;
+            *y1 = ty1 > *y1 ? ty1 : *y1;
+            *x1 = tx1 > *x1 ? tx1 : *x1;
+        }
+        return;
+    }
+    if (model->universe) {
+        universe_bounds(model->universe, y0, x0, y1, x1);
+        return;
+    }
+    *y0 = 0;
+    *x0 = 0;
+    *y1 = model->nrows;
+    *x1 = model->ncols;
+}
+
+void model_clear(Model *model)
+{
+    model->generation = 0;
+    model->hash = 0;
+    HashLife *tree = model_tree(model);
+    if (tree) {
+        tree->root = hashlife_empty(tree, HASHLIFE_MIN_LEVEL);
+        tree->origin_y = 0;
+        tree->origin_x = 0;
+    }
+    if (model->universe) {
+        universe_clear(model->universe);
+    }
+    else {
+        memset(model->grid, 0, (size_t) (model->nrows + 2) * model->stride * sizeof(uint64_t));
+    }
+}
+
+// fills rows [top, top + nrows) by columns [left, left + ncols), each cell
+// alive with chance percent, a word of cells at a time in row major order
+void model_random_fill(Model *model, int chance, int top, int left,
+        int nrows, int ncols, Rng *rng)
+{
+    int right = left + ncols;
+
+    for (int y = top; y < top + nrows; y++)
+    {
+        for (int x = floor_div(left, 64) * 64; x < right; x += 64)
+        {
+            uint64_t mask = ~UINT64_C(0);
+            if (x < left) {
+                mask <<= left - x;
+            }
+            if (right - x < 64) {
+                mask &= (UINT64_C(1) << (right - x)) - 1;
+            }
+            model_set_word(model, y, x, mask, rng_chance(rng, chance));
+        }
+    }
+}
+
+// hash of the current generation from scratch, but for hashlife's tree,
+// whose nodes keep theirs
+uint64_t model_hash(Model *model)
+{
+    uint64_t hash = 0;
+
+    if (model_tree(model)) {
+        model_flush_tree(model);
+        return hashlife_hash(model->hashlife);
+    }
+    if (!model->universe)
+    {
+        uint64_t power = 1;
+        for (int j = 0; j < model->nrows; j++)
+        {
+            uint64_t const *row = grid_row(model->grid, model, j);
+            hash += row_hash_delta(power, row, row, model->nwords);
+            power *= HASH_ROW;
+        }
+        return hash;
+    }
+
+    Universe *u = model->universe;
+    size_t n = universe_list(u);
+    for (size_t i = 0; i < n; i++)
+    {
+        Tile const *tile = u->list[i];
+        uint64_t power = word_power(tile->ty * UNIVERSE_TILE, tile->tx);
+        for (int r = 0; r < UNIVERSE_TILE; r++) {
+            hash += row_hash_delta(power, &tile->rows[u->cur][r], &tile->rows[u->cur][r], 1);
+            power *= HASH_ROW;
+        }
+    }
+    return hash;
+}
+
+uint64_t model_population(Model *model)
+{
+    uint64_t population = 0;
+
+    if (model_tree(model)) {
+        model_flush_tree(model);
+        return model->hashlife->root->population;
+    }
+    if (!model->universe)
+    {
+        for (int j = 0; j < model->nrows; j++)
+        {
+            uint64_t const *row = grid_row(model->grid, model, j);
+            for (int w = 0; w < model->nwords; w++) {
+                population += popcount(row[w]);
+            }
+        }
+        return population;
+    }
+
+    Universe *u = model->universe;
+    size_t n = universe_list(u);
+    for (size_t i = 0; i < n; i++) {
+        for (int r = 0; r < UNIVERSE_TILE; r++) {
+            population += popcount(u->list[i]->rows[u->cur][r]);
+        }
+    }
+    return population;
+}
+
+typedef void WordFn(void *ctx, int64_t y, int64_t x, uint64_t word);
+
+// a node of a strip of nodes spanning the same rows
+typedef struct StripNode{
+    Node const *node;
+    int64_t x;
+} StripNode;
+
+// calls fn for the live words of the n nodes of strip, which span the same
+// rows from y and are in order of x, in row major order. strips of nodes wider
+// than a word are split into their north and south halves first, leaving
+// out empty quadrants, so only the live parts of the tree are visited
+static void hashlife_each_word(StripNode const *strip, size_t n, int64_t y,
+        WordFn *fn, void *ctx)
+{
+    int level = strip[0].node->level;
+    if (level <= 6)
+    {
+        int nrows = 1 << level;
+        uint64_t *rows = calloc(n * nrows, sizeof *rows);
+        for (size_t i = 0; i < n; i++) {
+            node_rows(strip[i].node, 0, 0, &rows[i * nrows]);
+        }
+
+        for (int r = 0; r < nrows; r++) {
+            for (size_t i = 0; i < n; i++) {
+                if (rows[i * nrows + r]) {
+                    fn(ctx, y + r, strip[i].x, rows[i * nrows + r]);
+                }
+            }
+        }
+        free(rows);
+        return;
+    }
+
+    int64_t half = (int64_t) 1 << (level - 1);
+    StripNode *halves = malloc(2 * n * sizeof *halves);
+    for (int south = 0; south < 2; south++)
+    {
+        size_t m = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            Node const *west = south ? strip[i].node->sw : strip[i].node->nw;
+            Node const *east = south ? strip[i].node->se : strip[i].node->ne;
+            if (west->population) {
+                halves[m++] = (StripNode){west, strip[i].x};
+            }
+            if (east->population) {
+                halves[m++] = (StripNode){east, strip[i].x + half};
+            }
+        }
+        if (m > 0) {
+            hashlife_each_word(halves, m, y + south * half, fn, ctx);
+        }
+    }
+    free(halves);
+}
+
+static int compare_tiles(void const *a, void const *b)
+{
+    Tile const *ta = *(Tile *const *) a;
+    Tile const *tb = *(Tile *const *) b;
+
+    if (ta->ty != tb->ty) {
+        return ta->ty < tb->ty ? -1 : 1;
+    }
+    return ta->tx < tb->tx ? -1 : ta->tx > tb->tx;
+}
+
+// calls fn for every word holding live cells, in row major order, with
+// the word's row and first column. those of hashlife's tree may be past
+// the range of an int
+static void model_each_word(Model *model, WordFn *fn, void *ctx)
+{
+    HashLife const *tree = model_tree(model);
+    if (tree)
+    {
+        model_flush_tree(model);
+        if (tree->root->population > 0) {
+            StripNode root = {tree->root, tree->origin_x};
+            hashlife_each_word(&root, 1, tree->origin_y, fn, ctx);
+        }
+        return;
+    }
+    if (!model->universe)
+    {
+        for (int j = 0; j < model->nrows; j++)
+        {
+            uint64_t const *row = grid_row(model->grid, model, j);
+            for (int w = 0; w < model->nwords; w++) {
+                if (row[w]) {
+                    fn(ctx, j, w * 64, row[w]);
+                }
+            }
+        }
+        return;
+    }
+
+    Universe *u = model->universe;
+    size_t n = universe_list(u);
+    qsort(u->list, n, sizeof *(u->list), compare_tiles);
+
+    // each band of tiles in a tile row is walked a row at a time
+    for (size_t band = 0; band < n; )
+    {
+        size_t band_end = band;
+        while (band_end < n && u->list[band_end]->ty == u->list[band]->ty) {
+            band_end++;
+        }
+
+        for (int r = 0; r < UNIVERSE_TILE; r++)
+        {
+            for (size_t i = band; i < band_end; i++)
+            {
+                Tile const *tile = u->list[i];
+                if (tile->rows[u->cur][r]) {
+                    fn(ctx, tile->ty * UNIVERSE_TILE + r, tile->tx * UNIVERSE_TILE,
+                            tile->rows[u->cur][r]);
+                }
+            }
+        }
+        band = band_end;
+    }
+}
+
+// the plaintext .cells format for paths ending in .cells or .txt, RLE
+// otherwise
+PatternFormat pattern_format(char const *path)
+{
+    size_t len = strlen(path);
+    bool cells = len >= 6 && strcmp(path + len - 6, ".cells") == 0;
+    bool txt = len >= 4 && strcmp(path + len - 4, ".txt") == 0;
+
+    return cells || txt ? FORMAT_PLAINTEXT : FORMAT_RLE;
+}
+
+// moves pos, the reader's row or column from origin, count on. a position
+// whose model cell would pass INT_MAX fails the read instead
+static bool reader_advance(PatternReader *reader, int *pos, int origin, long count)
+{
+    if ((long long) *pos + count > INT_MAX || (long long) origin + *pos + count > INT_MAX) {
+        reader->error = true;
+        reader->state = READ_DONE;
+        return false;
+    }
+    *pos += (int) count;
+    return true;
+}
+
+static void reader_run(PatternReader *reader, bool alive)
+{
+    long count = reader->count > 0 ? reader->count : 1;
+    int x = reader->x;
+    reader->count = 0;
+
+    if (!reader_advance(reader, &reader->x, reader->left, count)) {
+        return;
+    }
+    if (alive) {
+        for (long i = 0; i < count; i++) {
+            model_set(reader->model, reader->top + reader->y, reader->left + x + (int) i, true);
+        }
+    }
+}
+
+// takes the rule from the rule field of the RLE header line, as in
+// "x = 3, y = 1, rule = B36/S23". a rule that doesn't parse, such as one
+// with more states, or that is B0 leaves the model's own
+static void reader_header(PatternReader *reader)
+{
+    reader->header_line[reader->header_len] = '\0';
+    char const *field = strstr(reader->header_line, "rule");
+    if (!field) {
+        return;
+    }
+    field += strspn(field + 4, " \t") + 4;
+    if (*field != '=') {
+        return;
+    }
+    field += strspn(field + 1, " \t") + 1;
+
+    // a suffix after ':' gives a bounded grid, which is --size's business
+    char text[64];
+    size_t len = strcspn(field, ":, \t\r");
+    if (len >= sizeof text) {
+        return;
+    }
+    memcpy(text, field, len);
+    text[len] = '\0';
+
+    Rule rule;
+    if (parse_rule(text, &rule) && !(rule.birth & 1)) {
+        reader->has_rule = true;
+        reader->rule = rule;
+    }
+}
+
+// parses the next chunk of a pattern file. chunks may split lines and
+// RLE runs anywhere, so the whole file never needs to be in memory
+void reader_feed(PatternReader *reader, char const *chunk, size_t len)
+{
+    for (size_t i = 0; i < len && reader->state != READ_DONE; i++)
+    {
+        char c = chunk[i];
+
+        switch (reader->state)
+        {
+            case READ_LINE_START:
+                if ((reader->format == FORMAT_RLE && c == '#')
+                    || (reader->format == FORMAT_PLAINTEXT && c == '!'))
+                {
+                    reader->state = READ_COMMENT;
+                    break;
+                }
+                if (reader->format == FORMAT_RLE && c == 'x' && !reader->header) {
+                    reader->header = true;
+                    reader->state = READ_HEADER;
+                    break;
+                }
+                reader->state = READ_BODY;
+                // the first character is body already
+                i--;
+                break;
+            case READ_COMMENT:
+                if (c == '\n') {
+                    reader->state = READ_LINE_START;
+                }
+                break;
+            case READ_HEADER:
+                if (c == '\n') {
+                    reader_header(reader);
+                    reader->state = READ_LINE_START;
+                }
+                else if (reader->header_len < sizeof reader->header_line - 1) {
+                    reader->header_line[reader->header_len++] = c;
+                }
+                break;
+            case READ_BODY:
+                if (c == '\n')
+                {
+                    reader->state = READ_LINE_START;
+                    if (reader->format == FORMAT_PLAINTEXT) {
+                        reader_advance(reader, &reader->y, reader->top, 1);
+                        reader->x = 0;
+                    }
+                }
+                else if (reader->format == FORMAT_PLAINTEXT)
+                {
+                    if (c == 'O' || c == '*') {
+                        reader_run(reader, true);
+                    }
+                    else if (c == '.') {
+                        reader_run(reader, false);
+                    }
+                }
+                else if (c >= '0' && c <= '9')
+                {
+                    reader->count = reader->count * 10 + (c - '0');
+                    if (reader->count > INT_MAX) {
+                        reader->error = true;
+                        reader->state = READ_DONE;
+                    }
+                }
+                else if (c == 'b' || c == '.') {
+                    reader_run(reader, false);
+                }
+                else if (c == '$')
+                {
+                    reader_advance(reader, &reader->y, reader->top,
+                            reader->count > 0 ? reader->count : 1);
+                    reader->x = 0;
+                    reader->count = 0;
+                }
+                else if (c == '!') {
+                    reader->state = READ_DONE;
+                }
+                else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                    // 'o', and the states of multi-state rules, are alive
+                    reader_run(reader, true);
+                }
+                else if (c != ' ' && c != '\t' && c != '\r') {
+                    reader->error = true;
+                    reader->state = READ_DONE;
+                }
+                break;
+            case READ_DONE:
+                break;
+        }
+    }
+}
+
+// adds the live cells of a pattern file to the model with the pattern's
+// top left at (top, left). regular files are mapped rather than read, so
+// even very large patterns are parsed in a single pass without copying
+bool pattern_load(Model *model, char const *path, int top, int left)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    PatternReader reader = {
+        .format = pattern_format(path),
+        .model = model,
+        .top = top,
+        .left = left,
+        .state = READ_LINE_START,
+    };
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    if (map != MAP_FAILED)
+    {
+        madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+        reader_feed(&reader, map, (size_t) st.st_size);
+        munmap(map, (size_t) st.st_size);
+    }
+    else
+    {
+        // pipes and the like are streamed instead
+        char chunk[1 << 16];
+        ssize_t len;
+        while ((len = read(fd, chunk, sizeof chunk)) > 0) {
+            reader_feed(&reader, chunk, (size_t) len);
+        }
+        if (len < 0) {
+            reader.error = true;
+        }
+    }
+    close(fd);
+
+    if (reader.error) {
+        errno = EINVAL;
+        return false;
+    }
+    if (reader.has_rule) {
+        model_set_rule(model, &reader.rule);
+    }
+    return true;
+}
+
+static void bounds_word(void *ctx, int64_t y, int64_t x, uint64_t word)
+{
+    PatternWriter *writer = ctx;
+    int64_t first = x + lowest_bit(word);
+    int64_t last = x + highest_bit(word);
+
+    if (writer->empty) {
+        writer->y0 = y;
+        writer->x0 = first;
+        writer->y1 = y;
+        writer->x1 = last;
+        writer->empty = false;
+    }
+    writer->x0 = first < writer->x0 ? first : writer->x0;
+    writer->x1 = last > writer->x1 ? last : writer->x1;
+    writer->y1 = y;
+}
+
+// writes count of an RLE tag, wrapping lines at 70 characters
+static void rle_put(PatternWriter *writer, int64_t count, char tag)
+{
+    char text[32];
+    int len = count > 1
+        ? snprintf(text, sizeof text, "%lld%c", (long long) count, tag)
+        : snprintf(text, sizeof text, "%c", tag);
+
+    if (writer->line_len + len > 70) {
+        fputc('\n', writer->file);
+        writer->line_len = 0;
+    }
+    fputs(text, writer->file);
+    writer->line_len += len;
+}
+
+// writes count dead (or live) cells, or count line ends
+static void writer_put(PatternWriter *writer, int64_t count, char tag)
+{
+    if (count <= 0) {
+        return;
+    }
+    if (writer->format == FORMAT_RLE) {
+        rle_put(writer, count, tag);
+        return;
+    }
+
+    char c = tag == '$' ? '\n' : tag == 'o' ? 'O' : '.';
+    for (int64_t i = 0; i < count; i++) {
+        fputc(c, writer->file);
+    }
+}
+
+// writes the pending run of live cells
+static void writer_flush(PatternWriter *writer)
+{
+    writer_put(writer, writer->run_x - writer->x, 'b');
+    writer_put(writer, writer->run_len, 'o');
+    writer->x = writer->run_x + writer->run_len;
+    writer->run_len = 0;
+}
+
+// adds a run of live cells, merging it with the pending one if adjacent
+static void writer_cells(PatternWriter *writer, int64_t y, int64_t x, int len)
+{
+    y -= writer->y0;
+    x -= writer->x0;
+
+    if (writer->run_len > 0 && y == writer->y && x == writer->run_x + writer->run_len) {
+        writer->run_len += len;
+        return;
+    }
+    if (writer->run_len > 0) {
+        writer_flush(writer);
+    }
+    if (y > writer->y) {
+        writer_put(writer, y - writer->y, '$');
+        writer->y = y;
+        writer->x = 0;
+    }
+    writer->run_x = x;
+    writer->run_len = len;
+}
+
+static void write_word(void *ctx, int64_t y, int64_t x, uint64_t word)
+{
+    while (word)
+    {
+        int first = lowest_bit(word);
+        // ones from first up
+        uint64_t run = word >> first;
+        int len = ~run ? lowest_bit(~run) : 64 - first;
+
+        writer_cells(ctx, y, x + first, len);
+        word = len + first < 64 ? word & (~UINT64_C(0) << (len + first)) : 0;
+    }
+}
+
+// writes the model's live cells, cropped to their bounding box
+bool pattern_save(Model *model, char const *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    PatternWriter writer = {
+        .file = file,
+        .format = pattern_format(path),
+        .empty = true,
+    };
+    model_each_word(model, bounds_word, &writer);
+
+    long long width = writer.empty ? 0 : writer.x1 - writer.x0 + 1;
+    long long height = writer.empty ? 0 : writer.y1 - writer.y0 + 1;
+    if (writer.format == FORMAT_RLE) {
+        fprintf(file, "#C generation %llu\n", (unsigned long long) model->generation);
+        char rule[32];
+        rule_format(&model->rule, rule, sizeof rule);
+        fprintf(file, "x = %lld, y = %lld, rule = %s\n", width, height, rule);
+    }
+    else {
+        fprintf(file, "!generation %llu\n", (unsigned long long) model->generation);
+    }
+
+    if (!writer.empty) {
+        model_each_word(model, write_word, &writer);
+        writer_flush(&writer);
+    }
+    if (writer.format == FORMAT_RLE) {
+        fputs("!\n", file);
+    }
+    else if (!writer.empty) {
+        fputc('\n', file);
+    }
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+// live neighbours of a cell, read straight from the grid. the cells just
+// past the edges are in the ghost border, so nothing is bounds checked
+static int num_neighbors(int celly, int cellx, Model const *model)
+{
+    int count = 0;
+    for (int j = -1; j <= 1; j++)
+    {
+        uint64_t const *row = grid_row(model->grid, model, celly + j);
+        count += grid_cell(row, cellx - 1) + grid_cell(row, cellx + 1);
+        if (j != 0) {
+            count += grid_cell(row, cellx);
+        }
+    }
+    return count;
+}
+
+// makes the generation just stepped into next the current one
+static void model_swap(Model *model)
+{
+    uint64_t *temp = model->grid;
+    model->grid = model->next;
+    model->next = temp;
+}
+
+// fills the ghost border of the current grid from the cells the boundary
+// maps it to. the west and east ghost columns go in first, so copying whole
+// rows into the ghost rows gets the corners right too
+static void model_fill_ghosts(Model *model)
+{
+    if (model->boundary == BOUNDARY_DEAD || model->nwords == 0) {
+        return;
+    }
+
+    bool torus = model->boundary == BOUNDARY_TORUS;
+    int west = torus ? model->ncols - 1 : 0;
+    int east = torus ? 0 : model->ncols - 1;
+    for (int j = 0; j < model->nrows; j++)
+    {
+        uint64_t *row = grid_row(model->grid, model, j);
+        grid_cell_set(row, -1, grid_cell(row, west));
+        grid_cell_set(row, model->ncols, grid_cell(row, east));
+    }
+
+    int north = torus ? model->nrows - 1 : 0;
+    int south = torus ? 0 : model->nrows - 1;
+    size_t size = (size_t) model->stride * sizeof(uint64_t);
+    memcpy(grid_row(model->grid, model, -1) - 1, grid_row(model->grid, model, north) - 1, size);
+    memcpy(grid_row(model->grid, model, model->nrows) - 1,
+            grid_row(model->grid, model, south) - 1, size);
+}
+
+// clears the ghost columns from a buffer that has been stepped from. the
+// active engine leaves settled tiles of the back buffer as they are, so
+// ghost cells left there would turn up in the grid. the ghost rows are
+// never read outside a step
+static void model_clear_ghosts(Model *model, uint64_t *grid)
+{
+    if (model->boundary == BOUNDARY_DEAD || model->nwords == 0) {
+        return;
+    }
+
+    for (int j = 0; j < model->nrows; j++)
+    {
+        uint64_t *row = grid_row(grid, model, j);
+        row[-1] = 0;
+        row[model->nwords - 1] &= model->tail_mask;
+        row[model->nwords] = 0;
+    }
+}
+
+// reference engine: evaluates each cell on its own
+static void step_scalar(Model *model)
+{
+    for (int j = 0; j < model->nrows; j++)
+    {
+        uint64_t const *row = grid_row(model->grid, model, j);
+        uint64_t *out = grid_row(model->next, model, j);
+        uint64_t *changed = model->changed;
+
+        // every word is written whole, so the buffer needs no clearing
+        for (int w = 0; w < model->nwords; w++)
+        {
+            uint64_t word = 0;
+
+            for (int i = w * 64; i < (w + 1) * 64 && i < model->ncols; i++)
+            {
+                int n = num_neighbors(j, i, model);
+                bool alive = grid_cell(row, i);
+
+                if (rule_next(&model->rule, alive, n))
+                {
+                    word |= UINT64_C(1) << (i % 64);
+                }
+            }
+            out[w] = word;
+            changed[w] = word ^ row[w];
+        }
+        changed[model->nwords - 1] &= model->tail_mask;
+        model->hash += row_hash_delta(word_power(j, 0), out, changed, model->nwords);
+    }
+
+    model_swap(model);
+}
+
+static void step_packed_band(Model *model, int row_begin, int row_end, uint64_t *changed)
+{
+    uint64_t delta = 0;
+    uint64_t power = word_power(row_begin, 0);
+
+    for (int j = row_begin; j < row_end && model->nwords > 0; j++)
+    {
+        uint64_t const *row = grid_row(model->grid, model, j);
+        uint64_t *out = grid_row(model->next, model, j);
+
+        model->step_row(grid_row(model->grid, model, j - 1), row,
+                grid_row(model->grid, model, j + 1),
+                out, changed, model->nwords, &model->rule);
+        // births past the last column are outside the grid
+        out[model->nwords - 1] &= model->tail_mask;
+        changed[model->nwords - 1] &= model->tail_mask;
+        delta += row_hash_delta(power, out, changed, model->nwords);
+        power *= HASH_ROW;
+    }
+    atomic_fetch_add(&model->hash, delta);
+}
+
+// word-parallel engine over the packed grid, split into row bands across
+// the worker pool when there is one
+static void step_packed(Model *model)
+{
+    if (model->pool) {
+        pool_run(model->pool, step_packed_band, model, 1);
+    }
+    else {
+        step_packed_band(model, 0, model->nrows, model->changed);
+    }
+
+    model_swap(model);
+}
+
+// whether tile (ty, tx) or one of its neighbours changed in the last step.
+// on a torus the tiles on opposite edges are neighbours
+static bool tile_near_change(Model const *model, int ty, int tx)
+{
+    bool torus = model->boundary == BOUNDARY_TORUS;
+
+    for (int y = ty - 1; y <= ty + 1; y++)
+    {
+        for (int x = tx - 1; x <= tx + 1; x++)
+        {
+            int wy = torus ? (y + model->ntile_rows) % model->ntile_rows : y;
+            int wx = torus ? (x + model->nwords) % model->nwords : x;
+            if (wy >= 0 && wy < model->ntile_rows && wx >= 0 && wx < model->nwords
+                && model->tiles[wy * model->nwords + wx])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// steps the runs of tiles near last step's changes. a tile skipped here
+// was unchanged last step, so the back buffer already holds its cells
+static void step_active_band(Model *model, int row_begin, int row_end, uint64_t *changed)
+{
+    uint64_t delta = 0;
+
+    for (int ty = row_begin / TILE_ROWS; ty * TILE_ROWS < row_end; ty++)
+    {
+        int tile_end = (ty + 1) * TILE_ROWS < row_end ? (ty + 1) * TILE_ROWS : row_end;
+        bool *flags = &model->tiles_next[ty * model->nwords];
+
+        int tx = 0;
+        while (tx < model->nwords)
+        {
+            if (!tile_near_change(model, ty, tx)) {
+                flags[tx++] = false;
+                continue;
+            }
+
+            int run_begin = tx;
+            while (tx < model->nwords && tile_near_change(model, ty, tx)) {
+                flags[tx++] = false;
+            }
+
+            uint64_t power = word_power(ty * TILE_ROWS, run_begin);
+            for (int j = ty * TILE_ROWS; j < tile_end; j++)
+            {
+                uint64_t const *row = grid_row(model->grid, model, j);
+                uint64_t *out = grid_row(model->next, model, j);
+
+                model->step_row(grid_row(model->grid, model, j - 1) + run_begin,
+                        row + run_begin,
+                        grid_row(model->grid, model, j + 1) + run_begin,
+                        out + run_begin, changed + run_begin, tx - run_begin,
+                        &model->rule);
+                if (tx == model->nwords) {
+                    out[tx - 1] &= model->tail_mask;
+                    changed[tx - 1] &= model->tail_mask;
+                }
+
+                for (int i = run_begin; i < tx; i++) {
+                    flags[i] |= changed[i] != 0;
+                }
+                delta += row_hash_delta(power, out + run_begin, changed + run_begin,
+                        tx - run_begin);
+                power *= HASH_ROW;
+            }
+        }
+    }
+    atomic_fetch_add(&model->hash, delta);
+}
+
+// packed engine that only recomputes tiles next to last step's changes,
+// so settled regions cost nothing
+static void step_active(Model *model)
+{
+    if (model->pool) {
+        pool_run(model->pool, step_active_band, model, TILE_ROWS);
+    }
+    else {
+        step_active_band(model, 0, model->nrows, model->changed);
+    }
+
+    model_swap(model);
+
+    bool *temp = model->tiles;
+    model->tiles = model->tiles_next;
+    model->tiles_next = temp;
+}
+
+// whether a tile has live cells, in either generation, on the edge or
+// corner facing its neighbour in direction (dy, dx)
+static bool tile_edge_live(Tile const *tile, int dy, int dx)
+{
+    uint64_t mask = dx < 0 ? UINT64_C(1) : dx > 0 ? UINT64_C(1) << 63 : ~UINT64_C(0);
+    int row_begin = dy > 0 ? UNIVERSE_TILE - 1 : 0;
+    int row_end = dy < 0 ? 1 : UNIVERSE_TILE;
+
+    for (int r = row_begin; r < row_end; r++) {
+        if ((tile->rows[0][r] | tile->rows[1][r]) & mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool tile_empty(Tile const *tile)
+{
+    uint64_t any = 0;
+    for (int r = 0; r < UNIVERSE_TILE; r++) {
+        any |= tile->rows[0][r] | tile->rows[1][r];
+    }
+    return any == 0;
+}
+
+// steps one tile into its back rows, adding the change to the generation
+// hash to hash. returns whether any cell flipped
+static bool universe_step_tile(Universe const *u, Tile *tile, RowFn *step_row,
+        Rule const *rule, uint64_t *hash)
+{
+    Tile const *near[3][3];
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            near[dy + 1][dx + 1] = universe_find(u, tile->ty + dy, tile->tx + dx);
+        }
+    }
+
+    // the tile's rows with a word of the west and east tiles either side,
+    // and a row of the tiles above and below
+    uint64_t rows[UNIVERSE_TILE + 2][3];
+    for (int r = -1; r <= UNIVERSE_TILE; r++)
+    {
+        int band = r < 0 ? 0 : r < UNIVERSE_TILE ? 1 : 2;
+        int source = r < 0 ? UNIVERSE_TILE - 1 : r < UNIVERSE_TILE ? r : 0;
+        for (int c = 0; c < 3; c++) {
+            Tile const *t = near[band][c];
+            rows[r + 1][c] = t ? t->rows[u->cur][source] : 0;
+        }
+    }
+
+    uint64_t changed = 0;
+    uint64_t power = word_power(tile->ty * UNIVERSE_TILE, tile->tx);
+    for (int r = 0; r < UNIVERSE_TILE; r++)
+    {
+        uint64_t flipped;
+        step_row(rows[r] + 1, rows[r + 1] + 1, rows[r + 2] + 1,
+                &tile->rows[!u->cur][r], &flipped, 1, rule);
+        changed |= flipped;
+        *hash += row_hash_delta(power, &tile->rows[!u->cur][r], &flipped, 1);
+        power *= HASH_ROW;
+    }
+    return changed != 0;
+}
+
+// steps the tiles that are dirty. before that, dirty tiles get neighbours
+// wherever they have live cells on the facing edge, and afterwards tiles
+// empty in both generations are freed, so the tiles follow the pattern.
+// returns the change to the generation hash
+static uint64_t universe_step(Universe *u, RowFn *step_row, Rule const *rule)
+{
+    uint64_t hash = 0;
+
+    size_t n = universe_list(u);
+    for (size_t i = 0; i < n; i++)
+    {
+        Tile const *tile = u->list[i];
+        if (!tile->dirty) {
+            continue;
+        }
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if ((dy || dx) && tile_edge_live(tile, dy, dx)) {
+                    universe_tile(u, tile->ty + dy, tile->tx + dx);
+                }
+            }
+        }
+    }
+
+    n = universe_list(u);
+    for (size_t i = 0; i < n; i++)
+    {
+        Tile *tile = u->list[i];
+        if (!tile->dirty || !universe_step_tile(u, tile, step_row, rule, &hash)) {
+            continue;
+        }
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                Tile *near = universe_find(u, tile->ty + dy, tile->tx + dx);
+                if (near) {
+                    near->dirty_next = true;
+                }
+            }
+        }
+    }
+
+    u->cur = !u->cur;
+    for (size_t i = 0; i < n; i++)
+    {
+        Tile *tile = u->list[i];
+        tile->dirty = tile->dirty_next;
+        tile->dirty_next = false;
+        if (tile_empty(tile)) {
+            universe_remove(u, tile);
+        }
+    }
+    return hash;
+}
+
+// node of the given level covering the model from (y, x), which is a
+// multiple of 64 columns from the model bounds. past (y_end, x_end) is dead
+static Node *hashlife_build(HashLife *hl, Model const *model, int level,
+        int64_t y, int64_t x, int64_t y_end, int64_t x_end)
+{
+    if (y >= y_end || x >= x_end) {
+        return hashlife_empty(hl, level);
+    }
+    if (level == 0) {
+        return &hl->cells[model_get(model, (int) y, (int) x)];
+    }
+
+    // a level 6 node spans exactly one word of each of its rows
+    if (level == 6)
+    {
+        bool empty = true;
+        for (int64_t j = y; j < y + 64 && j < y_end && empty; j++) {
+            empty = model_word(model, (int) j, (int) x) == 0;
+        }
+        if (empty) {
+            return hashlife_empty(hl, level);
+        }
+    }
+
+    int64_t half = (int64_t) 1 << (level - 1);
+    return hashlife_node(hl,
+        hashlife_build(hl, model, level - 1, y, x, y_end, x_end),
+        hashlife_build(hl, model, level - 1, y, x + half, y_end, x_end),
+        hashlife_build(hl, model, level - 1, y + half, x, y_end, x_end),
+        hashlife_build(hl, model, level - 1, y + half, x + half, y_end, x_end));
+}
+
+// replaces the universe with the model's cells
+static void hashlife_load(HashLife *hl, Model const *model)
+{
+    int y0, x0, y1, x1;
+    model_bounds(model, &y0, &x0, &y1, &x1);
+
+    int level = HASHLIFE_MIN_LEVEL;
+    while (((int64_t) 1 << level) < (int64_t) y1 - y0
+        || ((int64_t) 1 << level) < (int64_t) x1 - x0)
+    {
+        level++;
+    }
+
+    hl->root = hashlife_build(hl, model, level, y0, x0, y1, x1);
+    hl->origin_y = y0;
+    hl->origin_x = x0;
+}
+
+// sets the live cells of node, whose top left is at (y, x), in grid
+static void hashlife_store_node(Node const *node, int64_t y, int64_t x,
+        uint64_t *grid, Model const *model)
+{
+    int64_t size = (int64_t) 1 << node->level;
+    if (node->population == 0 || y >= model->nrows || x >= model->ncols
+        || y + size <= 0 || x + size <= 0)
+    {
+        return;
+    }
+
+    if (node->level == 0) {
+        grid_row(grid, model, (int) y)[x / 64] |= UINT64_C(1) << (x % 64);
+        return;
+    }
+
+    int64_t half = size / 2;
+    hashlife_store_node(node->nw, y, x, grid, model);
+    hashlife_store_node(node->ne, y, x + half, grid, model);
+    hashlife_store_node(node->sw, y + half, x, grid, model);
+    hashlife_store_node(node->se, y + half, x + half, grid, model);
+}
+
+// hashlife engine: advances 2^step_exp generations per step over an
+// unbounded universe. an unbounded model's cells are read from the tree
+// itself, while a bounded grid gets the part of it at (0, 0) stored
+static uint64_t step_hashlife(Model *model)
+{
+    if (model->universe) {
+        model_flush_tree(model);
+    }
+    uint64_t generations = hashlife_advance(model->hashlife);
+
+    if (model->universe) {
+        model->hash = hashlife_hash(model->hashlife);
+        return generations;
+    }
+
+    memset(model->next, 0, (size_t) (model->nrows + 2) * model->stride * sizeof(uint64_t));
+    hashlife_store_node(model->hashlife->root,
+            model->hashlife->origin_y, model->hashlife->origin_x,
+            model->next, model);
+
+    uint64_t power = 1;
+    for (int j = 0; j < model->nrows; j++)
+    {
+        uint64_t const *row = grid_row(model->grid, model, j);
+        uint64_t const *out = grid_row(model->next, model, j);
+        uint64_t *changed = model->changed;
+        for (int w = 0; w < model->nwords; w++) {
+            changed[w] = row[w] ^ out[w];
+        }
+        model->hash += row_hash_delta(power, out, changed, model->nwords);
+        power *= HASH_ROW;
+    }
+
+    model_swap(model);
+    return generations;
+}
+
+// brings engine state up to date with the grid. needed after cells are
+// set outside of a step: every tile is marked as changed so the active
+// engine recomputes them all, hashlife reloads a bounded grid into its
+// universe and the generation hash is recomputed
+void model_invalidate(Model *model)
+{
+    model->hash = model_hash(model);
+    for (int i = 0; i < model->ntile_rows * model->nwords; i++) {
+        model->tiles[i] = true;
+    }
+    if (model->universe) {
+        universe_invalidate(model->universe);
+    }
+    if (model->hashlife && !model->universe) {
+        hashlife_load(model->hashlife, model);
+    }
+}
+
+void model_step(Model *model)
+{
+    uint64_t generations = 1;
+
+    // the tiled universe steps only where its pattern is
+    if (model->universe && model->engine != ENGINE_HASHLIFE) {
+        model->hash += universe_step(model->universe, model->step_row, &model->rule);
+        model->generation++;
+        return;
+    }
+
+    // the grid stepped from ends up as the back buffer
+    model_fill_ghosts(model);
+
+    switch (model->engine)
+    {
+        case ENGINE_SCALAR:
+            step_scalar(model);
+            break;
+        case ENGINE_PACKED:
+            step_packed(model);
+            break;
+        case ENGINE_ACTIVE:
+            step_active(model);
+            break;
+        case ENGINE_HASHLIFE:
+            generations = step_hashlife(model);
+            break;
+    }
+    model_clear_ghosts(model, model->next);
+    model->generation += generations;
+}
+
+// generations each step advances
+uint64_t model_step_size(Model const *model)
+{
+    return model->engine == ENGINE_HASHLIFE ? UINT64_C(1) << model->hashlife->step_exp : 1;
+}
+
+void history_clear(History *history)
+{
+    memset(history->used, 0, sizeof history->used);
+}
+
+// looks up the hash of a generation, remembering it if new. returns whether
+// it was seen before, with the generation it was seen at in start
+bool history_repeat(History *history, uint64_t hash, uint64_t generation, uint64_t *start)
+{
+    size_t slot = hash % HISTORY_SLOTS;
+
+    if (history->used[slot] && history->hashes[slot] == hash) {
+        *start = history->generations[slot];
+        return true;
+    }
+    history->used[slot] = true;
+    history->hashes[slot] = hash;
+    history->generations[slot] = generation;
+    return false;
+}
+
+// appends value seven bits a byte, lowest first, returning the bytes used
+static size_t varint_put(unsigned char *out, uint64_t value)
+{
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (unsigned char) value;
+    return len;
+}
+
+static uint64_t varint_get(unsigned char const **in)
+{
+    uint64_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = *(*in)++;
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+// run length encodes words as records of a zero run length, a literal run
+// length and the literal words. a record costs no more than 9 bytes a word
+// it covers, plus a byte at either end
+static size_t words_encode(uint64_t const *words, size_t n, unsigned char *out)
+{
+    size_t len = 0;
+    size_t i = 0;
+
+    while (i < n)
+    {
+        size_t zeros_start = i;
+        while (i < n && words[i] == 0) {
+            i++;
+        }
+        size_t literals_start = i;
+        while (i < n && words[i] != 0) {
+            i++;
+        }
+        len += varint_put(out + len, literals_start - zeros_start);
+        len += varint_put(out + len, i - literals_start);
+        memcpy(out + len, words + literals_start, (i - literals_start) * sizeof *words);
+        len += (i - literals_start) * sizeof *words;
+    }
+    return len;
+}
+
+// XORs what words_encode wrote into words
+static void words_decode(unsigned char const *in, uint64_t *words, size_t n)
+{
+    size_t i = 0;
+
+    while (i < n)
+    {
+        i += varint_get(&in);
+        for (uint64_t literals = varint_get(&in); literals > 0; literals--)
+        {
+            uint64_t word;
+            memcpy(&word, in, sizeof word);
+            words[i++] ^= word;
+            in += sizeof word;
+        }
+    }
+}
+
+void timeline_clear(Timeline *timeline)
+{
+    timeline->head = 0;
+    timeline->used = 0;
+    timeline->first = 0;
+    timeline->count = 0;
+    timeline->deltas = KEYFRAME_INTERVAL;
+    timeline->failed = false;
+}
+
+// the most bytes a keyframe of a grid of this size can take: every word a
+// literal, behind a zero run and a literal count
+size_t timeline_keyframe_max(int nrows, int ncols)
+{
+    size_t nwords = (size_t) nrows * (size_t) ((ncols + 63) / 64);
+    return nwords * sizeof(uint64_t) + 20;
+}
+
+// a timeline for the model's grid keeping up to capacity bytes of
+// checkpoints, in a file mapped from path unless it is NULL. returns NULL
+// with errno set if the ring can't be set up
+Timeline *timeline_new(Model const *model, size_t capacity, char const *path)
+{
+    unsigned char *ring;
+    if (path)
+    {
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return NULL;
+        }
+        if (ftruncate(fd, (off_t) capacity) != 0) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return NULL;
+        }
+        ring = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int err = errno;
+        close(fd);
+        if (ring == MAP_FAILED) {
+            errno = err;
+            return NULL;
+        }
+    }
+    else {
+        ring = malloc(capacity);
+        if (!ring) {
+            return NULL;
+        }
+    }
+
+    Timeline *timeline = malloc(sizeof *timeline);
+    timeline->ring = ring;
+    timeline->capacity = capacity;
+    timeline->mapped = path != NULL;
+    timeline->nwords = (size_t) model->nrows * model->nwords;
+    timeline->reference = calloc(timeline->nwords, sizeof(uint64_t));
+    timeline->words = calloc(timeline->nwords, sizeof(uint64_t));
+    timeline->scratch = malloc(timeline->nwords * 9 + 2);
+    timeline_clear(timeline);
+
+    return timeline;
+}
+
+void timeline_destroy(Timeline *timeline)
+{
+    if (timeline->mapped) {
+        munmap(timeline->ring, timeline->capacity);
+    }
+    else {
+        free(timeline->ring);
+    }
+    free(timeline->reference);
+    free(timeline->words);
+    free(timeline->scratch);
+    free(timeline);
+}
+
+static Checkpoint *timeline_slot(Timeline *timeline, size_t index)
+{
+    return &timeline->slots[(timeline->first + index) % CHECKPOINT_SLOTS];
+}
+
+// drops the oldest checkpoint, and any deltas left without their keyframe
+static void timeline_drop(Timeline *timeline)
+{
+    do {
+        Checkpoint const *oldest = timeline_slot(timeline, 0);
+        timeline->head = (oldest->offset + oldest->size) % timeline->capacity;
+        timeline->used -= oldest->size;
+        timeline->first = (timeline->first + 1) % CHECKPOINT_SLOTS;
+        timeline->count--;
+    } while (timeline->count > 0 && !timeline_slot(timeline, 0)->keyframe);
+}
+
+// checkpoints the model if CHECKPOINT_INTERVAL generations have passed
+// since the newest checkpoint
+void timeline_record(Timeline *timeline, Model const *model)
+{
+    if (timeline->count > 0
+        && model->generation < timeline_slot(timeline, timeline->count - 1)->generation
+                + CHECKPOINT_INTERVAL)
+    {
+        return;
+    }
+    // a grid too big for the ring costs a whole keyframe each try
+    if (timeline->failed && model->generation >= timeline->failed_at
+        && model->generation < timeline->failed_at + CHECKPOINT_INTERVAL)
+    {
+        return;
+    }
+
+    for (int j = 0; j < model->nrows; j++)
+    {
+        uint64_t const *row = grid_row(model->grid, model, j);
+        uint64_t *reference = &timeline->reference[(size_t) j * model->nwords];
+        uint64_t *delta = &timeline->words[(size_t) j * model->nwords];
+        for (int w = 0; w < model->nwords; w++) {
+            delta[w] = row[w] ^ reference[w];
+            reference[w] = row[w];
+        }
+    }
+
+    bool keyframe = timeline->count == 0 || timeline->deltas + 1 >= KEYFRAME_INTERVAL;
+    size_t size = words_encode(keyframe ? timeline->reference : timeline->words,
+            timeline->nwords, timeline->scratch);
+
+    while (timeline->count > 0
+        && (timeline->capacity - timeline->used < size || timeline->count == CHECKPOINT_SLOTS))
+    {
+        timeline_drop(timeline);
+    }
+    // making room took the keyframe the delta was against
+    if (timeline->count == 0 && !keyframe) {
+        keyframe = true;
+        size = words_encode(timeline->reference, timeline->nwords, timeline->scratch);
+    }
+    if (size > timeline->capacity) {
+        timeline->deltas = KEYFRAME_INTERVAL;
+        timeline->failed = true;
+        timeline->failed_at = model->generation;
+        return;
+    }
+    timeline->failed = false;
+
+    size_t offset = (timeline->head + timeline->used) % timeline->capacity;
+    size_t split = timeline->capacity - offset < size ? timeline->capacity - offset : size;
+    memcpy(timeline->ring + offset, timeline->scratch, split);
+    memcpy(timeline->ring, timeline->scratch + split, size - split);
+    timeline->used += size;
+
+    *timeline_slot(timeline, timeline->count++) = (Checkpoint){
+        .generation = model->generation,
+        .offset = offset,
+        .size = size,
+        .keyframe = keyframe,
+    };
+    timeline->deltas = keyframe ? 0 : timeline->deltas + 1;
+}
+
+// oldest generation that can be sought back to. the timeline must hold a
+// checkpoint
+uint64_t timeline_start(Timeline *timeline)
+{
+    return timeline_slot(timeline, 0)->generation;
+}
+
+// restores the model to the newest checkpoint at or before generation,
+// returning false if there is none
+bool timeline_restore(Timeline *timeline, Model *model, uint64_t generation)
+{
+    if (timeline->count == 0 || timeline_start(timeline) > generation) {
+        return false;
+    }
+
+    size_t lo = 0;
+    size_t hi = timeline->count - 1;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (timeline_slot(timeline, mid)->generation <= generation) {
+            lo = mid;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    size_t keyframe = lo;
+    while (!timeline_slot(timeline, keyframe)->keyframe) {
+        keyframe--;
+    }
+
+    memset(timeline->words, 0, timeline->nwords * sizeof(uint64_t));
+    for (size_t i = keyframe; i <= lo; i++)
+    {
+        Checkpoint const *checkpoint = timeline_slot(timeline, i);
+        size_t split = timeline->capacity - checkpoint->offset < checkpoint->size
+            ? timeline->capacity - checkpoint->offset
+            : checkpoint->size;
+        memcpy(timeline->scratch, timeline->ring + checkpoint->offset, split);
+        memcpy(timeline->scratch + split, timeline->ring, checkpoint->size - split);
+        words_decode(timeline->scratch, timeline->words, timeline->nwords);
+    }
+
+    for (int j = 0; j < model->nrows; j++) {
+        memcpy(grid_row(model->grid, model, j), &timeline->words[(size_t) j * model->nwords],
+                (size_t) model->nwords * sizeof(uint64_t));
+    }
+    model->generation = timeline_slot(timeline, lo)->generation;
+    model_invalidate(model);
+    return true;
+}
+
+// milliseconds on a monotonic clock
+double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
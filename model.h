@@ -0,0 +1,283 @@
+#ifndef LIFE_MODEL_H
+#define LIFE_MODEL_H
+
+// the cell model and its stepping engines, with pattern files, cycle
+// detection and checkpoints, apart from any user interface
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// generation hashes remembered for cycle detection
+#define HISTORY_SLOTS 4096
+
+// rewinding: a checkpoint is kept every CHECKPOINT_INTERVAL generations,
+// every KEYFRAME_INTERVAL-th of them whole and the rest as deltas, in at
+// most CHECKPOINT_SLOTS slots and the timeline's capacity in bytes
+#define CHECKPOINT_INTERVAL 64
+#define KEYFRAME_INTERVAL 16
+#define CHECKPOINT_SLOTS 16384
+
+typedef enum Engine {ENGINE_SCALAR, ENGINE_PACKED, ENGINE_ACTIVE, ENGINE_HASHLIFE} Engine;
+
+static const char *const ENGINE_NAMES[] = {
+    [ENGINE_SCALAR] = "scalar",
+    [ENGINE_PACKED] = "packed",
+    [ENGINE_ACTIVE] = "active",
+    [ENGINE_HASHLIFE] = "hashlife",
+};
+
+// what lies past the edges of a bounded grid: dead cells, the opposite
+// edge, or the edge cells themselves
+typedef enum Boundary {BOUNDARY_DEAD, BOUNDARY_TORUS, BOUNDARY_MIRROR} Boundary;
+
+static const char *const BOUNDARY_NAMES[] = {
+    [BOUNDARY_DEAD] = "dead",
+    [BOUNDARY_TORUS] = "torus",
+    [BOUNDARY_MIRROR] = "mirror",
+};
+
+// the active engine tracks change per tile of one word (64 columns) by
+// TILE_ROWS rows
+#define TILE_ROWS 64
+
+// hashlife nodes are allocated in chunks of this many
+#define HASHLIFE_CHUNK 4096
+#define HASHLIFE_MAX_LEVEL 62
+// the root is kept at least this level, so it grows and steps by whole
+// words and its level 6 nodes line up with the words of a row
+#define HASHLIFE_MIN_LEVEL 7
+#define HASHLIFE_MAX_STEP_EXP 48
+
+// the unbounded universe is stored as tiles of this many cells square,
+// which makes each tile row a single word
+#define UNIVERSE_TILE 64
+
+// an outer totalistic rule: bit n of birth (survive) is set when a dead
+// (live) cell with n live neighbours is alive next generation
+typedef struct Rule{
+    unsigned birth;
+    unsigned survive;
+} Rule;
+
+static const Rule LIFE_RULE = {0x008, 0x00c};
+
+// xoshiro256** generator state, for random fills that a seed reproduces
+typedef struct Rng{
+    uint64_t s[4];
+} Rng;
+
+// computes one row of the next generation into out, and the cells that
+// flipped into changed. the words either side of each input row (padding
+// at the edges) must be readable
+typedef void RowFn(uint64_t const *above, uint64_t const *row, uint64_t const *below,
+        uint64_t *out, uint64_t *changed, int nwords, Rule const *rule);
+
+typedef struct Model Model;
+typedef struct Node Node;
+typedef struct HashLife HashLife;
+typedef struct Tile Tile;
+typedef struct Universe Universe;
+typedef struct Pool Pool;
+
+struct Model{
+    int nrows;
+    int ncols;
+    // cells are packed 64 to a word, lowest bit leftmost. each row has a
+    // padding word on either side and there is a padding row above and
+    // below, so the step kernel never needs a bounds check. the padding is
+    // dead, except that columns -1 and ncols and rows -1 and nrows form a
+    // ghost border refilled from the grid before each step for boundaries
+    // other than dead, and cleared again after
+    int nwords;
+    int stride;
+    // valid bits of the last word in each row
+    uint64_t tail_mask;
+    // current generation, and the buffer the next one is stepped into. the
+    // two swap roles every generation so stepping never allocates
+    uint64_t *grid;
+    uint64_t *next;
+    // scratch for the words flipped in the row being stepped, when stepping
+    // on the calling thread
+    uint64_t *changed;
+    // per tile, whether any of its cells flipped in the last step (tiles)
+    // and in the step being computed (tiles_next)
+    int ntile_rows;
+    bool *tiles;
+    bool *tiles_next;
+    Engine engine;
+    Boundary boundary;
+    // the rule, and the row kernel specialized for it if there is one
+    Rule rule;
+    RowFn *step_row;
+    // NULL when stepping on the calling thread only
+    Pool *pool;
+    // NULL unless the hashlife engine is used
+    HashLife *hashlife;
+    // NULL for a bounded grid. otherwise the cells live in this unbounded
+    // universe instead and the grid is empty. with the hashlife engine they
+    // live in its quadtree, and the universe is empty too
+    Universe *universe;
+    uint64_t generation;
+    // hash of the current generation (see HASH_ROW), kept up to date by the
+    // engines from the words that flip. bands add their share in atomically
+    _Atomic uint64_t hash;
+};
+
+// what model_new builds: a bounded nrows x ncols grid, or an unbounded
+// universe, stepped by engine under rule and boundary, with a worker pool
+// when nthreads is over 1. hashlife_nodes (the node cache cap) and step_exp
+// only matter to the hashlife engine
+typedef struct ModelConfig{
+    int nrows;
+    int ncols;
+    bool unbounded;
+    Engine engine;
+    Rule rule;
+    Boundary boundary;
+    int nthreads;
+    size_t hashlife_nodes;
+    int step_exp;
+} ModelConfig;
+
+// hashes of past generations, direct mapped by hash. a slot keeps the latest
+// generation to land in it, so an evicted state can delay spotting a cycle
+// by a period, but a repeat is never reported falsely (short of a 64 bit
+// hash collision)
+typedef struct History{
+    uint64_t hashes[HISTORY_SLOTS];
+    uint64_t generations[HISTORY_SLOTS];
+    bool used[HISTORY_SLOTS];
+} History;
+
+// where a checkpoint's encoding sits in the timeline's ring
+typedef struct Checkpoint{
+    uint64_t generation;
+    size_t offset;
+    size_t size;
+    bool keyframe;
+} Checkpoint;
+
+// checkpoints of past generations of a bounded grid, to seek back from.
+// a checkpoint is the grid XORed with the previous checkpoint (or with an
+// empty grid, for a keyframe), run length encoded over zero words, so it
+// is rebuilt from the keyframe before it. the oldest checkpoints are
+// dropped once the ring or the slots are full, which keeps memory bounded
+// however long the run
+typedef struct Timeline{
+    // encodings back to back from head, wrapping around. the ring is
+    // mapped from a file when spilling to one
+    unsigned char *ring;
+    size_t capacity;
+    size_t head;
+    size_t used;
+    bool mapped;
+    // checkpoints oldest first from slot first, wrapping around
+    Checkpoint slots[CHECKPOINT_SLOTS];
+    size_t first;
+    size_t count;
+    // deltas since the last keyframe, KEYFRAME_INTERVAL to force one
+    int deltas;
+    // whether the last checkpoint tried didn't fit the ring, and its
+    // generation. another is only tried CHECKPOINT_INTERVAL generations on
+    bool failed;
+    uint64_t failed_at;
+    // the grid's words without padding: as at the newest checkpoint, and
+    // scratch for a delta or a rebuilt generation
+    size_t nwords;
+    uint64_t *reference;
+    uint64_t *words;
+    // room for one encoding, at most 9 bytes a word
+    unsigned char *scratch;
+} Timeline;
+
+typedef enum PatternFormat {FORMAT_RLE, FORMAT_PLAINTEXT} PatternFormat;
+
+// incremental pattern parser, fed the file in chunks of any size
+typedef struct PatternReader{
+    PatternFormat format;
+    Model *model;
+    // model cell the pattern's top left goes to, and the current cell
+    // relative to it
+    int top;
+    int left;
+    int y;
+    int x;
+    // RLE run count read so far
+    long count;
+    enum {READ_LINE_START, READ_COMMENT, READ_HEADER, READ_BODY, READ_DONE} state;
+    bool header;
+    bool error;
+    // the start of the RLE header line, and the rule it names if the
+    // engines can run it
+    char header_line[128];
+    size_t header_len;
+    bool has_rule;
+    Rule rule;
+} PatternReader;
+
+typedef struct PatternWriter{
+    FILE *file;
+    PatternFormat format;
+    // bounding box of the live cells, inclusive
+    bool empty;
+    int64_t y0;
+    int64_t x0;
+    int64_t y1;
+    int64_t x1;
+    // next cell to write, relative to the bounding box
+    int64_t y;
+    int64_t x;
+    // live cells not written yet, so runs across words are merged
+    int64_t run_x;
+    int64_t run_len;
+    int line_len;
+} PatternWriter;
+
+int floor_div(int v, int d);
+
+void rng_seed(Rng *rng, uint64_t seed);
+uint64_t rng_next(Rng *rng);
+uint64_t rng_chance(Rng *rng, int chance);
+
+void rule_format(Rule const *rule, char *text, size_t size);
+bool parse_rule(char const *arg, Rule *rule);
+
+Model *model_new(ModelConfig const *config);
+void model_destroy(Model *model);
+bool model_contains(Model const *model, int celly, int cellx);
+bool model_get(Model const *model, int celly, int cellx);
+void model_set(Model *model, int celly, int cellx, bool alive);
+uint64_t model_word(Model const *model, int y, int x);
+void model_set_word(Model *model, int y, int x, uint64_t mask, uint64_t bits);
+bool model_block_alive(Model const *model, int y, int x, int size);
+void model_bounds(Model const *model, int *y0, int *x0, int *y1, int *x1);
+void model_clear(Model *model);
+void model_random_fill(Model *model, int chance, int top, int left,
+        int nrows, int ncols, Rng *rng);
+uint64_t model_hash(Model *model);
+uint64_t model_population(Model *model);
+void model_invalidate(Model *model);
+void model_step(Model *model);
+uint64_t model_step_size(Model const *model);
+
+PatternFormat pattern_format(char const *path);
+void reader_feed(PatternReader *reader, char const *chunk, size_t len);
+bool pattern_load(Model *model, char const *path, int top, int left);
+bool pattern_save(Model *model, char const *path);
+
+void history_clear(History *history);
+bool history_repeat(History *history, uint64_t hash, uint64_t generation, uint64_t *start);
+
+size_t timeline_keyframe_max(int nrows, int ncols);
+Timeline *timeline_new(Model const *model, size_t capacity, char const *path);
+void timeline_destroy(Timeline *timeline);
+void timeline_clear(Timeline *timeline);
+void timeline_record(Timeline *timeline, Model const *model);
+uint64_t timeline_start(Timeline *timeline);
+bool timeline_restore(Timeline *timeline, Model *model, uint64_t generation);
+
+double now_ms(void);
+
+#endif